@@ -0,0 +1,14 @@
+#!/bin/bash
+# time-to-target of the portfolio against thread count
+# usage: ./bench_portfolio.sh <target objective> <time limit> <solver args...>
+# prints "<threads> <seconds until a SAT assignment with objective <= target>"
+
+target=$1
+limit=$2
+shift 2
+
+for threads in 1 2 4 8 16 32 64; do
+    ./solver --threads $threads --time $limit "$@" | awk -v target=$target -v threads=$threads '
+        /^#incumbent:/ { if ($3 == 0 && $4 <= target && !found) { found = 1; print threads, $2 } }
+        END { if (!found) print threads, "inf" }'
+done
@@ -48,12 +48,24 @@ void Assignment::allocateAuxiliaryMemory(Variable maxVar) {
 //     return _assignment[var];
 // }
 
+void OperatorPool::init(Int varCnt) {
+    _varEpoch.assign(varCnt, 0);
+    _varHead.assign(varCnt, -1);
+    _epoch = 1;
+    clear();
+}
+
 void OperatorPool::clear() {
     if (JUDGE) assert(_vars.size() == _vals.size());
     _vars.clear();
     _vals.clear();
-    _operatorSet.clear();
+    _chainVal.clear();
+    _chainNext.clear();
     _size = 0;
+    if (++_epoch == 0) {        // wrapped, stale stamps could match again
+        std::fill(_varEpoch.begin(), _varEpoch.end(), 0);
+        _epoch = 1;
+    }
 }
 
 Int OperatorPool::size() {
@@ -74,23 +86,75 @@ void OperatorPool::push(Variable var, Int val) {
     }
 }
 
+/**
+ * @brief batch insertion of the values a generator found for one var
+ *        var is stamped once, every value is checked against the chain before the batch and the values before it
+ */
+void OperatorPool::push(Variable var, const Int* vals, Int cnt) {
+    if (JUDGE) assert(_vars.size() == _vals.size());
+    if (JUDGE) assert(_vars.size() == _size);
+    if (JUDGE) assert(var < _varEpoch.size());
+    if (cnt == 0) return;
+
+    if (_varEpoch[var] != _epoch) {
+        _varEpoch[var] = _epoch;
+        _varHead[var]  = -1;
+    }
+    Int oldHead = _varHead[var];
+    reserve(_vars.size() + cnt);
+
+    for (Int i = 0; i < cnt; i++) {
+        Int  val  = vals[i];
+        bool have = false;
+        for (Int j = 0; j < i && !have; j++) have = vals[j] == val;
+        for (Int entry = oldHead; entry != -1 && !have; entry = _chainNext[entry]) have = _chainVal[entry] == val;
+        if (have) continue;
+
+        _vars.push_back(var);
+        _vals.push_back(val);
+        _chainVal.push_back(val);
+        _chainNext.push_back(_varHead[var]);
+        _varHead[var] = _chainVal.size() - 1;
+        _size++;
+    }
+}
+
+/**
+ * @brief room for cnt operators, grows geometrically so repeated batches stay amortized O(1)
+ */
+void OperatorPool::reserve(Int cnt) {
+    if ((Int) _vars.capacity() >= cnt) return;
+    Int capacity = std::max<Int>(cnt, 2 * _vars.capacity());
+    _vars.reserve(capacity);
+    _vals.reserve(capacity);
+    _chainVal.reserve(capacity);
+    _chainNext.reserve(capacity);
+}
+
 bool OperatorPool::empty() const {
     if (JUDGE) assert(_vars.size() == _vals.size());
     return _vars.empty();
 }
 
 bool OperatorPool::haveOperator(const Variable& var, const Int& val) {
-    if (_operatorSet.count(var) != 0 && _operatorSet[var].count(val) != 0) return true;
+    if (JUDGE) assert(var < _varEpoch.size());
+    if (_varEpoch[var] != _epoch) return false;
+    for (Int entry = _varHead[var]; entry != -1; entry = _chainNext[entry]) {
+        if (_chainVal[entry] == val) return true;
+    }
     return false;
 }
 
 void OperatorPool::addOperator(const Variable& var, const Int& val) {
     if (JUDGE) assert(!haveOperator(var, val));
 
-    if (_operatorSet.count(var) == 0) {
-        _operatorSet.insert(std::make_pair(var, Set<Int>()));
+    if (_varEpoch[var] != _epoch) {
+        _varEpoch[var] = _epoch;
+        _varHead[var]  = -1;
     }
-    _operatorSet[var].insert(val);
+    _chainVal.push_back(val);
+    _chainNext.push_back(_varHead[var]);
+    _varHead[var] = _chainVal.size() - 1;
 }
 
 Variable OperatorPool::varAt(Int index) const {
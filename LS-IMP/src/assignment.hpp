@@ -46,7 +46,7 @@ protected:
     Int* _lb;
     Int* _ub;
 public:
-    Variable varCnt() { return _varCnt;}
+    Variable varCnt() const { return _varCnt;}
     Assignment() : _varCnt(Variable::undef) {}
     ~Assignment() { if (_varCnt != Variable::undef) freeAuxiliaryMemory(); }
     void allocateAuxiliaryMemory(Variable maxVar);
@@ -71,19 +71,33 @@ public:
 //     Int      _val;
 // }; 
 
+/**
+ * @brief candidate (var, val) moves of one step, cleared at the top of every move generator
+ *        storage is kept across clear(), so after warm-up a step allocates nothing
+ *        dedup: a var stamped with the current epoch owns a chain of the values pushed for it,
+ *        clear() bumps the epoch instead of touching the per var arrays
+ */
 class OperatorPool {
 protected:
     vector<Variable> _vars;
     vector<Int>      _vals;
-    Int              _size;
+    Int              _size;         // sampling window, removeOpAt shrinks it
 
-    Map<unsigned, Set<Int> >_operatorSet;
+    uint32_t         _epoch;
+    vector<uint32_t> _varEpoch;     // .at(var) == _epoch iff var has operators in the pool
+    vector<Int>      _varHead;      // first chain entry of var, valid iff stamped
+    vector<Int>      _chainVal;     // chain entries, one per push, independent of removeOpAt
+    vector<Int>      _chainNext;    // -1 ends the chain
+
+    void reserve(Int cnt);
 
 public:
-    OperatorPool() { _size = 0; }
+    OperatorPool() { _size = 0; _epoch = 1; }
+    void init(Int varCnt);
     void clear();
     Int  size();
     void push(Variable var, Int val);
+    void push(Variable var, const Int* vals, Int cnt);
     bool empty() const;
 
     bool haveOperator(const Variable& var, const Int& val);
@@ -0,0 +1,87 @@
+#include "batch.hpp"
+#include "portfolio.hpp"
+#include "presolve.hpp"
+
+namespace LS_NIA {
+
+QueryBatch::QueryBatch(Instance& instance, const Options& options, Int threadCnt, bool presolve)
+    : _instance(instance), _options(options), _threadCnt(threadCnt), _presolve(presolve) {
+    _options._printResult = false;
+}
+
+vector<Int> QueryBatch::parseQueries(const Instance& instance, const string& spec) {
+    vector<Int> queries;
+    if (spec == "all") {
+        for (Int demandIndex = 0; demandIndex < instance.getDemandCnt(); demandIndex++) queries.push_back(demandIndex);
+        return queries;
+    }
+    for (const string& demandID : util::splitStr(spec, ',')) {
+        if (demandID.empty()) continue;
+        Int demandIndex = instance.findDemand(demandID);
+        if (demandIndex == Instance::undef) util::showError("Unknown query demand " + demandID);
+        queries.push_back(demandIndex);
+    }
+    return queries;
+}
+
+QueryBatch::Result QueryBatch::solveQuery(const NIA_Formula& queryFormula, vector<Int>& warmValues, bool useNewVersion) const {
+    TimePoint queryTime = util::getTimePoint();
+    Result    result;
+    vector<Int> bestValues;
+
+    Presolver   presolver(queryFormula);
+    NIA_Formula reducedFormula;
+    vector<Int> initValues(warmValues);
+    if (_presolve) {
+        reducedFormula = presolver.presolve();
+        if (!initValues.empty()) initValues = presolver.presolveValues(initValues);
+    }
+    const NIA_Formula& formula = _presolve ? reducedFormula : queryFormula;
+
+    if (_threadCnt > 0) {
+        Portfolio portfolio(formula, _options, _threadCnt);
+        if (!initValues.empty()) portfolio.setInitValues(initValues);
+        portfolio.solve(useNewVersion);
+        if (!portfolio.getBest(bestValues, result._unSatConsNum, result._objectiveValue)) {
+            result._unSatConsNum   = formula.getConsCnt();
+            result._objectiveValue = -NEGATIVE_INFINITY;
+        }
+    }
+    else {
+        LsSolver solver(formula, _options);
+        if (!initValues.empty()) solver.setInitValues(initValues);
+        solver.solve(useNewVersion);
+        solver.getBestValues(bestValues);
+        result._unSatConsNum   = solver.getBestUnSatConsNum();
+        result._objectiveValue = solver.getBestObjectiveValue();
+    }
+    result._seconds = util::getSeconds(queryTime);
+
+    if (result._unSatConsNum == 0) warmValues = _presolve ? presolver.postsolve(bestValues) : bestValues;
+    return result;
+}
+
+void QueryBatch::solve(const vector<Int>& queries, bool useNewVersion) {
+    TimePoint   coreTime = util::getTimePoint();
+    NIA_Formula core     = _instance.genCoreFormula();
+    cout << "#core: " << core.getVarCnt() << " vars, " << core.getConsCnt() << " cons in " << util::getSeconds(coreTime) << "s" << endl;
+    cout << "#query: demandID demandValue result supplied seconds" << endl;
+
+    vector<Int> warmValues;
+    Int satCnt = 0;
+    for (Int demandIndex : queries) {
+        NIA_Formula formula = _instance.genQueryFormula(core, demandIndex);
+        Result      result  = solveQuery(formula, warmValues, useNewVersion);
+
+        bool sat = result._unSatConsNum == 0;
+        satCnt += sat;
+        cout << "#query: " << _instance.getDemandID(demandIndex) << " " << _instance.getDemandValue(demandIndex) << " "
+             << (sat ? "SAT" : "UNSAT") << " ";
+        if (sat) cout << -result._objectiveValue;       // objective is -(supply of the demand)
+        else cout << "-";
+        cout << " " << result._seconds << endl;
+    }
+    cout << "#queries: " << queries.size() << "  SAT: " << satCnt << "  time: " << util::getSeconds(coreTime) << endl;
+}
+
+} // namespace LS_NIA
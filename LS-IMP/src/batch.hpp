@@ -0,0 +1,41 @@
+#pragma once
+
+#include "utils.hpp"
+#include "formula.hpp"
+#include "instacne.hpp"
+#include "lsearch.hpp"
+
+namespace LS_NIA {
+
+/**
+ * @brief "how much can demand X be supplied" for a list of demands of one Instance
+ *        the constraint core is generated once, a query only relaxes its own demand limit and swaps the objective
+ *        queries run back to back, each one on a portfolio if threadCnt > 0
+ *        a query starts from the best assignment of the last SAT query, the vars are the same in every query
+ */
+class QueryBatch {
+protected:
+    Instance& _instance;
+    Options   _options;
+    Int       _threadCnt;
+    bool      _presolve;                 // presolve every query formula, warm values are mapped in and out
+
+    struct Result {
+        Int   _unSatConsNum;
+        Float _objectiveValue;
+        Float _seconds;
+    };
+
+    Result solveQuery(const NIA_Formula& formula, vector<Int>& warmValues, bool useNewVersion) const;
+
+public:
+    QueryBatch(Instance& instance, const Options& options, Int threadCnt, bool presolve = false);
+
+    // "all", or demand IDs separated by ','
+    static vector<Int> parseQueries(const Instance& instance, const string& spec);
+
+    // one "#query:" row per demand, in the order of queries
+    void solve(const vector<Int>& queries, bool useNewVersion = true);
+};
+
+} // namespace LS_NIA
@@ -22,19 +22,37 @@ ostream& operator << (ostream &out, const Monomial& mono) {
     return out;
 }
 
+ostream& operator << (ostream &out, const MonomialRef& mono) {
+    if (mono._coef > 0) out << "+" << mono._coef;
+    else if (mono._coef < 0) out << mono._coef;
+    else {
+        out << "0";
+        return out;
+    }
+    out << " ";
+    for(const Variable& var : mono._vars) {
+        out << "x" << var;
+    }
+    return out;
+}
+
 ostream& operator << (ostream &out, const Polynomial& poly) {
     if (poly.empty()) {
         out << "0";
         return out;
     }
-    for (const Monomial& mono : poly._monoVec) {
+    for (const MonomialRef& mono : poly.getMonoVec()) {
         out << mono << " ";
     }
     return out;
 }
 
 ostream& operator << (ostream &out, const Constraint& cons) {
-    out << cons._poly;
+    if (cons.isFactored()) {
+        const vector<Polynomial>& f = cons._factors;
+        out << "(" << f[0] << ") * (" << f[1] << ") - (" << f[2] << ") * (" << f[3] << ")";
+    }
+    else out << cons._poly;
 
     if (cons._op == Op::GEQUAL) out << " >= ";
     else if (cons._op == Op::LEQUAL) out << " <= ";
@@ -96,51 +114,119 @@ bool Monomial::isContain(const Variable& var) const {
     return false;
 }
 
+bool MonomialRef::isContain(const Variable& var) const {
+    for(const Variable& _var : _vars) {
+        if (_var == var) return true;
+    }
+    return false;
+}
+
+uint64_t Polynomial::hashVars(uint32_t begin, uint32_t end) const {
+    uint64_t hash = end - begin;
+    for (uint32_t i = begin; i < end; i++) {
+        hash = (hash ^ (unsigned) _vars[i]) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+bool Polynomial::isTermVars(Int term, uint32_t begin, uint32_t end) const {
+    uint32_t termVarBegin = termBegin(term);
+    if (_termEnd[term] - termVarBegin != end - begin) return false;
+    return std::equal(_vars.begin() + begin, _vars.begin() + end, _vars.begin() + termVarBegin);
+}
+
+// a var tuple already in the index keeps pointing to its first term, as the scan finds it
+void Polynomial::indexTerms() {
+    Int termCnt = _coefs.size();
+    if ((Int) _termHash.size() < 2 * termCnt) {
+        Int size = 32;
+        while (size < 4 * termCnt) size <<= 1;
+        _termHash.assign(size, -1);
+        _hashedCnt = 0;
+    }
+    uint64_t mask = _termHash.size() - 1;
+    for (; _hashedCnt < termCnt; _hashedCnt++) {
+        uint32_t begin = termBegin(_hashedCnt);
+        uint32_t end   = _termEnd[_hashedCnt];
+        uint64_t pos   = hashVars(begin, end) & mask;
+        while (_termHash[pos] != -1 && !isTermVars(_termHash[pos], begin, end)) pos = (pos + 1) & mask;
+        if (_termHash[pos] == -1) _termHash[pos] = _hashedCnt;
+    }
+}
+
+Int Polynomial::findTerm(uint32_t begin, uint32_t end) {
+    Int termCnt = _coefs.size();
+    if (termCnt < HASH_MIN_TERM) {
+        for (Int term = 0; term < termCnt; term++) {
+            if (isTermVars(term, begin, end)) return term;
+        }
+        return -1;
+    }
+
+    indexTerms();
+    uint64_t mask = _termHash.size() - 1;
+    for (uint64_t pos = hashVars(begin, end) & mask; _termHash[pos] != -1; pos = (pos + 1) & mask) {
+        if (isTermVars(_termHash[pos], begin, end)) return _termHash[pos];
+    }
+    return -1;
+}
+
+// the new term is merged into an equal one or kept as the last term
+void Polynomial::addPending(uint32_t begin, Float coef) {
+    _normalFlag = false;
+    std::sort(_vars.begin() + begin, _vars.end());
+    Int term = findTerm(begin, _vars.size());
+    if (term != -1) {
+        _coefs[term] += coef;
+        _vars.resize(begin);
+    }
+    else {
+        _coefs.push_back(coef);
+        _termEnd.push_back(_vars.size());
+    }
+}
+
+// vars must not point into this polynomial
+void Polynomial::addTerm(const Variable* vars, Int varCnt, Float coef) {
+    uint32_t begin = _vars.size();
+    _vars.insert(_vars.end(), vars, vars + varCnt);
+    addPending(begin, coef);
+}
+
+void Polynomial::pushBack(const Variable* vars, Int varCnt, Float coef) {
+    uint32_t begin = _vars.size();
+    _vars.insert(_vars.end(), vars, vars + varCnt);
+    std::sort(_vars.begin() + begin, _vars.end());
+    _coefs.push_back(coef);
+    _termEnd.push_back(_vars.size());
+}
+
 Polynomial Polynomial::operator + (const Polynomial& poly) const {
     Polynomial res(poly);
-    for (const Monomial & mono : _monoVec) {
-        res += mono;
+    for (Int termCnt = _coefs.size(), term = 0; term < termCnt; term++) {
+        res.addTerm(_vars.data() + termBegin(term), _termEnd[term] - termBegin(term), _coefs[term]);
     }
     res.normalized();
-    return std::move(res);
+    return res;
 }
 
 // -= and += without normalized to minimize normalized times
 Polynomial& Polynomial::operator += (const Monomial& mono) { 
-    bool found = false;
-    _normalFlag = false;
-    for (Int size = _monoVec.size(), i = 0; i < size; i++) {           // ??? O(n) need update?
-        if (_monoVec[i] == mono) {
-            assert(!found);
-            _monoVec[i] += mono;
-            found = true;
-        }
-    }
-    
-    if(!found) _monoVec.push_back(mono);
+    addTerm(mono.getVars().data(), mono.getVars().size(), mono.getCoef());
     return *this;
 }
 
 // -= and += without normalized to minimize normalized times
 Polynomial& Polynomial::operator -= (const Monomial& mono) { 
-    bool found  = false;
-    _normalFlag = false;
-    for (Int size = _monoVec.size(), i = 0; i < size; i++) {           // ??? O(n) need update?
-        if (_monoVec[i] == mono) {
-            assert(!found);
-            _monoVec[i] -= mono;
-            found = true;
-        }
-    }
-    
-    if(!found) _monoVec.push_back(-mono);
+    addTerm(mono.getVars().data(), mono.getVars().size(), -mono.getCoef());
     return *this;
 }
 
 Polynomial Polynomial::operator - (const Polynomial& poly) const {
     Polynomial res(*this);
-    for (const Monomial& mono : poly._monoVec) {
-        res -= mono;
+    for (Int termCnt = poly._coefs.size(), term = 0; term < termCnt; term++) {
+        res.addTerm(poly._vars.data() + poly.termBegin(term), poly._termEnd[term] - poly.termBegin(term), -poly._coefs[term]);
     }
     res.normalized();
     return res;
@@ -148,35 +234,69 @@ Polynomial Polynomial::operator - (const Polynomial& poly) const {
 
 Polynomial Polynomial::operator - () const {
     Polynomial res;
-    for (const Monomial& mono : _monoVec) {
-        res -= mono;
+    res.reserve(_coefs.size(), _vars.size());
+    for (Int termCnt = _coefs.size(), term = 0; term < termCnt; term++) {
+        res.addTerm(_vars.data() + termBegin(term), _termEnd[term] - termBegin(term), -_coefs[term]);
     }
     res.normalized();
-    return std::move(res);
+    return res;
 }
 
+// drop empty terms in place, vars of the kept terms are shifted down
 void Polynomial::normalized() {
     _linearFlag = true;
-    for (auto it = _monoVec.begin(); it != _monoVec.end(); ) {
-        if (it->empty()) {
-            it = _monoVec.erase(it);    // delete empty mono
-        }
-        else {
-            if (!it->isLinear()) _linearFlag = false;
-            it++;
+    uint32_t begin   = 0;
+    uint32_t varCnt  = 0;
+    Int      termCnt = 0;
+    for (Int size = _coefs.size(), term = 0; term < size; term++) {
+        uint32_t end = _termEnd[term];
+        if (end != begin && _coefs[term] != 0) {
+            if (end - begin != 1) _linearFlag = false;
+            std::copy(_vars.begin() + begin, _vars.begin() + end, _vars.begin() + varCnt);
+            varCnt += end - begin;
+            _coefs[termCnt]     = _coefs[term];
+            _termEnd[termCnt++] = varCnt;
         }
+        begin = end;
     }
+    _coefs.resize(termCnt);
+    _termEnd.resize(termCnt);
+    _vars.resize(varCnt);
+    vector<Int>().swap(_termHash);      // terms were renumbered, built again if terms are added later
+    _hashedCnt  = 0;
     _normalFlag = true;
 }
 
+// the product term is built in res._vars directly, no Monomial temporaries
 Polynomial Polynomial::operator * (const Polynomial& poly) const {
     Polynomial res;
-    for (const Monomial& mono1 : _monoVec) {
-        for (const Monomial& mono2 : poly._monoVec) {
-            res += mono1 * mono2;
+    for (Int termCnt1 = _coefs.size(), term1 = 0; term1 < termCnt1; term1++) {
+        for (Int termCnt2 = poly._coefs.size(), term2 = 0; term2 < termCnt2; term2++) {
+            uint32_t begin = res._vars.size();
+            res._vars.insert(res._vars.end(), poly._vars.begin() + poly.termBegin(term2), poly._vars.begin() + poly._termEnd[term2]);
+            res._vars.insert(res._vars.end(), _vars.begin() + termBegin(term1), _vars.begin() + _termEnd[term1]);
+            res.addPending(begin, poly._coefs[term2] * _coefs[term1]);
         }
     }
-    return std::move(res);
+    return res;
+}
+
+/**
+ * @brief l1 * l2 - l3 * l4 [op] limit, stored without expanding the products
+ *        every l is a linear form, a var must not appear in both factors of one product
+ */
+void NIA_Formula::addFactoredConstraint(Polynomial l1, Polynomial l2, Polynomial l3, Polynomial l4, Op op, Float limit) {
+    vector<Polynomial> factors;
+    factors.reserve(Constraint::factorCnt);
+    factors.push_back(std::move(l1));
+    factors.push_back(std::move(l2));
+    factors.push_back(std::move(l3));
+    factors.push_back(std::move(l4));
+    for (Polynomial& factor : factors) {
+        factor.normalized();
+        if (!factor.empty() && !factor.isLinear()) util::showError("Factor of factored constraint must be linear");
+    }
+    _consVec.push_back(Constraint(std::move(factors), op, limit));
 }
 
 void NIA_Formula::judgeConstraints() const {
@@ -207,10 +327,10 @@ void lpReader::readObjectiveFunction(NIA_Formula& formula, string line, Map<stri
         else {
             var = varMap.at(varStr);
         }
-        objectiveFunction += Monomial(var, coef);
+        objectiveFunction.addTerm(var, coef);
     }
-    formula.addObjectiveFunction(objectiveFunction);
     if (DEBUG && true) cout << "Objective funtion: " << objectiveFunction << endl;
+    formula.addObjectiveFunction(std::move(objectiveFunction));
 }
 
 void lpReader::readConstraint(NIA_Formula& formula, string line, Map<string, Int>& varMap) {
@@ -236,7 +356,7 @@ void lpReader::readConstraint(NIA_Formula& formula, string line, Map<string, Int
                 var = varMap.at(varStr);
             }
 
-            mono = mono * Monomial(var, 1);
+            mono *= var;
         }
         else if (words.at(i) == "<=") {
             // poly += mono;
@@ -277,8 +397,8 @@ void lpReader::readConstraint(NIA_Formula& formula, string line, Map<string, Int
         }
     }
     assert(op != Op::UNDEF);
-    formula.addConstraint(poly, op, limit);
     if (DEBUG && false) cout << "Add constraint" << poly << endl;
+    formula.addConstraint(std::move(poly), op, limit);
 }
 
 void lpReader::readVars(NIA_Formula& formula, string line, Map<string, Int>& varMap) {
@@ -328,6 +448,10 @@ NIA_Formula lpReader::readLpFile(string fileName) {
 
     formula.setVarCnt(varMap.size());
 
+    vector<string> varNames(varMap.size());
+    for (const auto& p : varMap) varNames.at(p.second) = p.first;
+    formula.setVarNames(varNames);
+
     // std::ofstream fout("mapping.out");
     // for (auto p : varMap) {
     //     fout << p.first << " -> " << p.second << endl;
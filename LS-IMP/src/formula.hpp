@@ -44,24 +44,26 @@ public:
 // };
 
 class Polynomial;
+class MonomialRange;
+class FormulaCache;
 class Monomial {
 	friend ostream & operator << (ostream & out, const Monomial& mono);
+	friend class FormulaCache;
 protected:
 	vector<Variable> _vars;		// ??? multi vars? sorted
 	Float 			 _coef;		// ??? need long double ? or long long
 	bool 			 _normalFlag;
 public:
 	Monomial(){}
-	Monomial(const Monomial& mono) : _vars(mono._vars), _coef(mono._coef), _normalFlag(mono._normalFlag) {}
-	explicit Monomial(vector<Variable> vars, Float coef) : _vars(vars), _coef(coef), _normalFlag(false) {}
+	explicit Monomial(vector<Variable> vars, Float coef) : _vars(std::move(vars)), _coef(coef), _normalFlag(false) {}
 	explicit Monomial(Variable var, Float coef) : _coef(coef) { _vars.clear(); _vars.push_back(var); normalized();}
 
-	Monomial& operator =  (const Monomial& m) { _vars = m._vars; _coef = m._coef; _normalFlag = m._normalFlag; return *this;}
 	bool      operator == (const Monomial& m) const;
 	Monomial& operator += (const Monomial& mono);
 	Monomial& operator -= (const Monomial& mono);
 	Monomial  operator -  () const;
 	Monomial  operator *  (const Monomial& mono) const;
+	Monomial& operator *= (Variable var) { _vars.push_back(var); normalized(); return *this; }		// in place, no temporary
 
 	inline bool empty() const { return _vars.size() == 0 || _coef == 0;}
 	inline void clear() { _vars.clear(); _coef = NEGATIVE_INFINITY; }
@@ -77,18 +79,81 @@ public:
 	inline void normalized() { std::sort(_vars.begin(), _vars.end()); _normalFlag = true; }		// sort _vars;
 };
 
+/**
+ * @brief read only range of vars, points into the flat storage of a Polynomial
+ */
+class VarSpan {
+protected:
+	const Variable* _begin;
+	const Variable* _end;
+public:
+	VarSpan(const Variable* begin, const Variable* end) : _begin(begin), _end(end) {}
+
+	inline const Variable* begin() const { return _begin; }
+	inline const Variable* end()   const { return _end; }
+	inline Int  size()  const { return _end - _begin; }
+	inline bool empty() const { return _begin == _end; }
+	inline const Variable& operator [] (Int i) const { return _begin[i]; }
+	inline const Variable& front() const { return *_begin; }
+	inline const Variable& back()  const { return *(_end - 1); }
+};
+
+/**
+ * @brief view of one term of a Polynomial, same interface as a const Monomial
+ *        valid until the Polynomial is modified
+ */
+class MonomialRef {
+	friend ostream & operator << (ostream & out, const MonomialRef& mono);
+protected:
+	VarSpan _vars;
+	Float 	_coef;
+public:
+	MonomialRef(const Variable* begin, const Variable* end, Float coef) : _vars(begin, end), _coef(coef) {}
+
+	inline const VarSpan& getVars() const { return _vars; }
+	inline Float getCoef() const { return _coef; }
+
+	inline bool empty() const { return _vars.empty() || _coef == 0; }
+	inline bool isLinear() const { return _coef != 0 && _vars.size() == 1; }
+	bool isContain(const Variable& var) const;
+};
+
 enum Op {LEQUAL, EQUAL, GEQUAL, UNDEF};
 
+// POLYNOMIAL: expanded sum of monomials
+// FACTORED:   factor[0] * factor[1] - factor[2] * factor[3], every factor is a linear form
+enum ConsKind {POLYNOMIAL, FACTORED};
+
+/**
+ * @brief terms of a Polynomial in flat arrays instead of one heap allocated Monomial per term
+ *        term i: _coefs[i], vars _vars[_termEnd[i - 1] .. _termEnd[i]) (from 0 for i == 0), sorted
+ *        three allocations per Polynomial however many terms it has, evaluation reads them linearly
+ */
 class Polynomial {
 	friend ostream & operator << (ostream & out, const Polynomial& poly);
+	friend class FormulaCache;
 protected:
 	// sum(mono)
-	vector<Monomial> _monoVec;
+	vector<Float>	 _coefs;
+	vector<uint32_t> _termEnd;
+	vector<Variable> _vars;
 	bool 			 _linearFlag;
 	bool 			 _normalFlag;
+
+	// open addressing index var tuple -> first term with it, built on demand while terms are added, dropped by normalized()
+	vector<Int>		 _termHash;		// term or -1, size is a power of 2 and at least twice the indexed terms
+	Int				 _hashedCnt;	// terms [0, _hashedCnt) are in _termHash
+
+	const static Int HASH_MIN_TERM = 16;	// shorter polynomials are scanned
+
+	inline uint32_t termBegin(Int term) const { return term == 0 ? 0 : _termEnd[term - 1]; }
+	uint64_t hashVars(uint32_t begin, uint32_t end) const;
+	bool isTermVars(Int term, uint32_t begin, uint32_t end) const;
+	void indexTerms();
+	Int  findTerm(uint32_t begin, uint32_t end);			// term with the vars _vars[begin, end), -1 if none
+	void addPending(uint32_t begin, Float coef);			// vars of a new term already appended at _vars[begin, )
 public:
-	Polynomial() { _normalFlag = false; }
-	Polynomial(const Polynomial& poly) : _monoVec(poly._monoVec), _linearFlag(poly._linearFlag), _normalFlag(poly._normalFlag) { }
+	Polynomial() : _hashedCnt(0) { _linearFlag = true; _normalFlag = false; }
 	Polynomial  operator +  (const Polynomial& poly) const;
 	Polynomial& operator += (const Monomial& mono);
 	Polynomial& operator -= (const Monomial& mono);
@@ -96,48 +161,114 @@ public:
 	Polynomial  operator -  () const;
 	Polynomial  operator *  (const Polynomial& poly) const;
 
-	inline bool empty() const { return _monoVec.size() == 0;}
-	const vector<Monomial>& getMonoVec() const { return _monoVec; }
+	// builders, += without a Monomial temporary, equal terms are merged
+	void addTerm(Variable var, Float coef) { addTerm(&var, 1, coef); }
+	void addTerm(const Variable* vars, Int varCnt, Float coef);
+
+	inline bool empty() const { return _coefs.size() == 0;}
+	inline Int  getTermCnt() const { return _coefs.size(); }
+	inline MonomialRef getTerm(Int term) const {
+		return MonomialRef(_vars.data() + termBegin(term), _vars.data() + _termEnd[term], _coefs[term]);
+	}
+	MonomialRange getMonoVec() const;
 	inline bool isLinear() const { return _linearFlag; }
 	inline bool isNormal() const { return _normalFlag; }
 
-	void pushBack(const Monomial& mono) { _monoVec.push_back(mono); } 
+	// appended as is, not merged
+	void pushBack(const Variable* vars, Int varCnt, Float coef);
+	void pushBack(Variable var, Float coef) { pushBack(&var, 1, coef); }
+	void pushBack(const Monomial& mono) { pushBack(mono.getVars().data(), mono.getVars().size(), mono.getCoef()); }
+	void reserve(Int termCnt, Int varCnt) { _coefs.reserve(termCnt); _termEnd.reserve(termCnt); _vars.reserve(varCnt); }
 
 	void normalized();
 };
 
+/**
+ * @brief terms of a Polynomial, iterated and indexed like the former vector<Monomial>
+ */
+class MonomialRange {
+protected:
+	const Polynomial* _poly;
+public:
+	class Iterator {
+	protected:
+		const Polynomial* _poly;
+		Int 			  _term;
+	public:
+		Iterator(const Polynomial* poly, Int term) : _poly(poly), _term(term) {}
+		inline MonomialRef operator * () const { return _poly->getTerm(_term); }
+		inline Iterator& operator ++ () { _term++; return *this; }
+		inline bool operator != (const Iterator& other) const { return _term != other._term; }
+	};
+
+	explicit MonomialRange(const Polynomial& poly) : _poly(&poly) {}
+
+	inline Iterator begin() const { return Iterator(_poly, 0); }
+	inline Iterator end()   const { return Iterator(_poly, _poly->getTermCnt()); }
+	inline Int  size()  const { return _poly->getTermCnt(); }
+	inline bool empty() const { return _poly->empty(); }
+	inline MonomialRef operator [] (Int i) const { return _poly->getTerm(i); }
+};
+
+inline MonomialRange Polynomial::getMonoVec() const { return MonomialRange(*this); }
+
 class Constraint {
 	friend ostream & operator << (ostream & out, const Constraint& cons);
+	friend class FormulaCache;
 protected:
-	Polynomial 	_poly;
+	Polynomial 	_poly;				// empty for FACTORED
+	vector<Polynomial> _factors;	// linear forms, only for FACTORED
 	Float 	   	_limit;
 	Op			_op;
+	ConsKind	_kind;
 public:
-	Constraint() : _limit(NEGATIVE_INFINITY), _op(Op::UNDEF) {}
-	explicit Constraint(Polynomial poly, Op op, Float limit) : _poly(poly),  _limit(limit), _op(op) { }
+	Constraint() : _limit(NEGATIVE_INFINITY), _op(Op::UNDEF), _kind(ConsKind::POLYNOMIAL) {}
+	explicit Constraint(Polynomial poly, Op op, Float limit) : _poly(std::move(poly)),  _limit(limit), _op(op), _kind(ConsKind::POLYNOMIAL) { }
+	explicit Constraint(vector<Polynomial> factors, Op op, Float limit) : _factors(std::move(factors)), _limit(limit), _op(op), _kind(ConsKind::FACTORED) { }
 
 	const Polynomial& getPolynomial() const { return _poly; }
 	const Int         getLimit()      const { return _limit; }
 	const Op          getOp()         const { return _op; }
-	const vector<Monomial>& getMonoVec() const { return _poly.getMonoVec(); }
-	inline bool isLinear() const { return _poly.isLinear(); }
+	const ConsKind    getKind()       const { return _kind; }
+	MonomialRange getMonoVec() const { return _poly.getMonoVec(); }
+	const vector<Polynomial>& getFactors() const { return _factors; }
+	inline bool isLinear() const { return _kind == ConsKind::POLYNOMIAL && _poly.isLinear(); }
+	inline bool isFactored() const { return _kind == ConsKind::FACTORED; }
+
+	const static Int factorCnt = 4;
+	// sign of factor[k] * factor[k ^ 1] in the constraint value
+	static inline Int factorSign(Int k) { return k < 2 ? 1 : -1; }
 };
 
 class NIA_Formula {
+	friend class FormulaCache;
 protected:
 	Int 			   _varCnt;
 	vector<Constraint> _consVec;
 	Polynomial		   _objectiveFuntion;
+	vector<string>	   _varNames;		// var -> original id (lp name or usr/supply/demand ids), may be empty
+	vector<Int>		   _varLB;			// explicit bounds, e.g. from presolve, empty: lb 0 and ub only from <= constraints
+	vector<Int>		   _varUB;			// DUMMY_MAX_INT if unbounded
 public:
 	inline void setVarCnt(Int varCnt) { _varCnt = varCnt; }
 	inline Int  getVarCnt() const { return _varCnt; }
 	inline Int  getConsCnt() const { return _consVec.size(); }
 	const vector<Constraint>& getConsVec() const { return _consVec; }
 
-	void addConstraint(Polynomial poly, Op op, Float limit) {poly.normalized(); _consVec.push_back(Constraint(poly, op, limit));}
-	void addObjectiveFunction(Polynomial poly) { _objectiveFuntion = poly; }
+	void addConstraint(Polynomial poly, Op op, Float limit) {poly.normalized(); _consVec.push_back(Constraint(std::move(poly), op, limit));}
+	void addFactoredConstraint(Polynomial l1, Polynomial l2, Polynomial l3, Polynomial l4, Op op, Float limit);		// l1 * l2 - l3 * l4 [op] limit
+	void removeConstraint(Int consIndex) { _consVec.erase(_consVec.begin() + consIndex); }		// later constraints shift down by one
+	void addObjectiveFunction(Polynomial poly) { _objectiveFuntion = std::move(poly); }
 	const Polynomial& getObjectiveFunction() const { return _objectiveFuntion; }
 
+	void setVarNames(const vector<string>& varNames) { _varNames = varNames; }
+	const vector<string>& getVarNames() const { return _varNames; }
+
+	void setVarBounds(const vector<Int>& lb, const vector<Int>& ub) { _varLB = lb; _varUB = ub; }
+	inline bool hasVarBounds() const { return !_varLB.empty(); }
+	inline Int  getVarLB(Variable var) const { return _varLB[var]; }
+	inline Int  getVarUB(Variable var) const { return _varUB[var]; }
+
 	void judgeConstraints() const;
 	// void read
 };
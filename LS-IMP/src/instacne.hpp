@@ -1,3 +1,5 @@
+#pragma once
+
 #include "utils.hpp"
 #include "formula.hpp"
 
@@ -6,47 +8,69 @@ namespace LS_NIA {
 class Instance  {
 protected:
     Int _usrCnt, _supplyCnt, _demandCnt;
-    Map<string, Int> _usrMap;            // discretization usrID -> usrIndex
-    Map<string, Int> _supplyMap;         // supplyID -> supplyIndex
-    Map<string, Int> _demandMap;         // demandID -> demandIndex
+    StrInterner _usrIDs;                 // discretization usrID <-> usrIndex
+    StrInterner _supplyIDs;              // supplyID <-> supplyIndex
+    StrInterner _demandIDs;              // demandID <-> demandIndex
 
     vector<Int> _demandValue;            // .at(demandIndex) = demandValue
+    vector<Int> _demandConsIndex;        // .at(demandIndex) = index of its demand limit constraint in the last generated formula, -1 if none
     
     vector<vector<Int> > _usrSupply;     // .at(usrIndex).at(i) = ith supplyment of usr
     vector<vector<Int> > _usrDemand;     // .at(usrIndex).at(i) = index linked to demandTable by user with ith supplyment 
     // ??? Maybe stored a pair here
-    vector<vector<Pair<Int, Int> > > _demand2US;     // .at(demandIndex).at(i) = <usrIndex, supplyIndex>
+    vector<vector<Pair<Int, Int> > > _demand2US;     // .at(demandIndex).at(i) = <tableRow, pos>, _demandTable.at(tableRow).at(pos) = demandIndex
+    vector<Int> _rowUsr;                 // .at(tableRow) = usrIndex
+    vector<Int> _rowSupply;              // .at(tableRow) = supplyIndex
+    Set<uint64_t> _usrSupplyKey;         // (usrIndex << 32) | supplyIndex of every row read
     
     Int _tableCnt;
+    Int _niaNum;                         // number of NIA (ratio) constraints
     vector<vector<Int> > _demandTable;   // read from sample file, at(i) linked with usrDemand
                                         // demandTable.at(i).at(0) is the limit on .at(i).at(j) where j > 0
 
+    Random _random;                      // stream 0 of the master seed, query generation
+    Int    _readThreadCnt;               // sample file chunks parsed in parallel
+
     Variable _varCnt;                    // used for genFormula
-    Map<string, Variable> _varMap;       // map str to varID;
+    vector<Int>      _rowVarBase;        // .at(tableRow) = first var slot of the row, one slot per demand
+    vector<Variable> _slotVar;           // .at(_rowVarBase.at(tableRow) + pos - 1) = var of <usr, supply, demand at pos>, undef until used
     // Map<Variable, string> strMap;       // map varID to str; for DEBUG
  
-    void addUsr(string usrID);
-    void addSupply(string supplyID);
-    void addDemand(string demandID);
+    void addUsr();
+    void addSupply();
+    void addDemand(Int demandValue);
+
+
+    /**
+     * @brief sample rows of one file chunk, parsed by one thread
+     *        spans point into the mapped file, demand lists are resolved to indices and deduped
+     */
+    struct SampleChunk {
+        struct Row {
+            StrSpan  _usrID, _supplyID;
+            uint64_t _usrHash, _supplyHash;
+            Int      _supplyLimit;
+            size_t   _demandBegin, _demandEnd;     // [begin, end) in _demandIndex
+        };
+        vector<Row> _rows;
+        vector<Int> _demandIndex;
+    };
 
-    inline bool haveUsr(string usrID)       const { return _usrMap.count(usrID) != 0; }
-    inline bool haveSupply(string supplyID) const { return _supplyMap.count(supplyID) != 0;}
-    inline bool haveDemand(string demandID) const { return _demandMap.count(demandID) != 0;}
-    inline bool haveVar(string queryStr)    const { return _varMap.count(queryStr) != 0;}
+    bool isSampledLine(StrSpan line) const;
+    void parseSampleChunk(const char* begin, const char* end, char splitChar, SampleChunk& chunk) const;
+    void addSampleRow(const SampleChunk& chunk, const SampleChunk::Row& row);
 
-    Int getUsrIndex(string usrID) const;
-    Int getSupplyIndex(string supplyID) const;
-    Int getDemandIndex(string demandID) const;
-    // ??? Do wo need index -> id ?
+    inline Int varSlot(Int tableRow, Int pos) const { return _rowVarBase[tableRow] + pos - 1; }     // pos >= 1, at(0) is the limit
 
-    void     addVar(string queryStr);
-    Variable getVar(Int usrID, Int supplyID, Int demandID);
-    bool     haveVar(Int usrID, Int supplyID, Int demandID) const;
+    Variable getVar(Int tableRow, Int pos);
+    bool     haveVar(Int tableRow, Int pos) const { return _slotVar[varSlot(tableRow, pos)] != Variable::undef; }
+    string   varStr(Int tableRow, Int pos) const;     // "usrID supplyID demandID"
 
     void genUsrSupplyFormula(NIA_Formula& formula);
     void genDemandLimitFormula(NIA_Formula& formula, Int queryIndex);
     void genMutliLinearFormula(NIA_Formula& formula);
     void genObjectiveFunction(NIA_Formula& formula, Int queryDemandIndex);
+    void genVarNames(NIA_Formula& formula) const;
 
     void displayDemand2US() const;      // for DEBUG
 public:
@@ -54,10 +78,22 @@ public:
     void readDemandFile(string filePath);
     void readSampleFile(string filePath);
 
-    Instance() : _usrCnt(0), _supplyCnt(0), _demandCnt(0), _tableCnt(0) {}
+    Instance() : _usrCnt(0), _supplyCnt(0), _demandCnt(0), _tableCnt(0), _niaNum(NIA_NUM), _random(randomSeed), _readThreadCnt(1), _varCnt(Variable::start) {}
+
+    inline void setNiaNum(Int niaNum) { _niaNum = niaNum; }
+    inline void setReadThreadCnt(Int readThreadCnt) { _readThreadCnt = std::max<Int>(readThreadCnt, 1); }
 
     NIA_Formula genFormula();
 
+    // multi query: constraints shared by every query are generated once, a query only swaps its demand
+    NIA_Formula genCoreFormula();                                           // every demand limit kept, no objective
+    NIA_Formula genQueryFormula(const NIA_Formula& core, Int queryDemandIndex);   // core without the query's demand limit, maximize its supply
+
+    inline Int getDemandCnt() const { return _demandCnt; }
+    inline Int getDemandValue(Int demandIndex) const { return _demandValue.at(demandIndex); }
+    inline Int findDemand(const string& demandID) const { return _demandIDs.find(StrSpan(demandID.data(), demandID.data() + demandID.size())); }   // undef if unknown
+    inline string getDemandID(Int demandIndex) const { return _demandIDs.key(demandIndex).str(); }
+
     const static Int undef;
 };
 
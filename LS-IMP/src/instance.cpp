@@ -1,16 +1,15 @@
 #include "instacne.hpp"
 
+#include <thread>
+
 namespace LS_NIA {
 
 const Int Instance::undef = -1;
 
-void Instance::addUsr(string usrID) {
-    assert(_usrMap.count(usrID) == 0);
-    _usrMap.insert(std::make_pair(usrID, _usrCnt++));
-    if (DEBUG && false) {
-        cout << "Add Usr: " << usrID << " -> " << getUsrIndex(usrID) << endl; 
-    }
-    
+void Instance::addUsr() {
+    _usrCnt++;
+    assert(_usrIDs.size() == _usrCnt);
+
     _usrSupply.push_back(vector<Int>());
     assert(_usrSupply.size() == _usrCnt);
 
@@ -18,149 +17,185 @@ void Instance::addUsr(string usrID) {
     assert(_usrDemand.size() == _usrCnt);
 }
 
-void Instance::addSupply(string supplyID) {
-    assert(_supplyMap.count(supplyID) == 0);
-    _supplyMap.insert(std::make_pair(supplyID, _supplyCnt++));
-    if (DEBUG && false) {
-        cout << "Add Supply: " << supplyID << " -> " << getSupplyIndex(supplyID) << endl; 
-    }
+void Instance::addSupply() {
+    _supplyCnt++;
+    assert(_supplyIDs.size() == _supplyCnt);
 }
 
-void Instance::addDemand(string demandID) {
-    assert(_demandMap.count(demandID) == 0);
-    _demandMap.insert(std::make_pair(demandID, _demandCnt++));
-    if (DEBUG && false) {
-        cout << "Add Demand: " << demandID << " -> " << getDemandIndex(demandID) << endl;
-    }
-}
+void Instance::addDemand(Int demandValue) {
+    _demandCnt++;
+    assert(_demandIDs.size() == _demandCnt);
 
-Int Instance::getUsrIndex(string usrID) const {
-    if (haveUsr(usrID)) return _usrMap.at(usrID);
-    else return undef;
+    _demandValue.push_back(demandValue / DEMAND_DIVISOR);    // 5w original
+    assert(_demandValue.size() == _demandCnt);
 }
 
-Int Instance::getSupplyIndex(string supplyID) const {
-    if (haveSupply(supplyID)) return _supplyMap.at(supplyID);
-    else return undef;
+/**
+ * @brief demandID`demandValue per line
+ */
+void Instance::readDemandFile(string filePath) {
+    MappedFile file(filePath);
+    assert(_demandCnt == 0);
+
+    StrSpan rest(file.data(), file.data() + file.size());
+    while (!rest.empty()) {
+        StrSpan line = rest.cut('\n');
+        if (!line.empty() && line._end[-1] == '\r') line._end--;
+        if (line.empty()) continue;
+
+        StrSpan demandID = line.cut('`');
+        if (line.empty()) util::showError("Bad demand line: " + demandID.str());
+
+        bool inserted;
+        _demandIDs.intern(demandID, inserted);
+        if (!inserted) util::showError("Duplicate demandID " + demandID.str());
+        addDemand(util::parseInt(line._begin, line._end));
+    }
 }
 
-Int Instance::getDemandIndex(string demandID) const {
-    if (haveDemand(demandID)) return _demandMap.at(demandID);
-    else return undef;
+/**
+ * @brief keep READ_RATE % of the rows, decided by the content of the line
+ *        the same subset is kept whatever the chunking or thread count
+ */
+bool Instance::isSampledLine(StrSpan line) const {
+    return (Int) ((util::hashBytes(line._begin, line.size()) ^ (uint64_t) randomSeed) % 100) <= READ_RATE;
 }
 
-void Instance::readDemandFile(string filePath) {
-    std::ifstream fileStream(filePath);
-    string line;
-    assert(_demandCnt == 0);
-    while (getline(fileStream, line)) {
-        // cout << "line: " << line << endl;
-        vector<string> demandData = util::splitStr(line, '`');
-        assert(demandData.size() == 2);
-        string demandID = demandData.at(0);
-        Int demandV = std::stoi(demandData.at(1));
-
-        if (!haveDemand(demandID)) addDemand(demandID);
-        else util::showError("Duplicate demandID " + demandData.at(0));
-
-        _demandValue.push_back(demandV / DEMAND_DIVISOR);    // 5w original
-        assert(_demandValue.size() == _demandCnt);
+/**
+ * @brief parse the lines of [begin, end), read-only on the instance, safe to run in parallel
+ */
+void Instance::parseSampleChunk(const char* begin, const char* end, char splitChar, SampleChunk& chunk) const {
+    vector<Int> demandStamp(_demandCnt, -1);       // .at(demandIndex) = last row listing it
+
+    StrSpan rest(begin, end);
+    while (!rest.empty()) {
+        StrSpan line = rest.cut('\n');
+        if (!line.empty() && line._end[-1] == '\r') line._end--;
+        if (line.empty() || !isSampledLine(line)) continue;
+
+        SampleChunk::Row row;
+        row._usrID              = line.cut(splitChar);
+        row._supplyID           = line.cut(splitChar);
+        StrSpan supplyLimit     = line.cut(splitChar);
+        StrSpan demandList      = line;
+        if (supplyLimit._end == demandList._begin || memchr(demandList._begin, splitChar, demandList.size()) != nullptr) {
+            util::showError("Bad sample line, expect 4 fields: " + row._usrID.str());
+        }
+        row._usrHash     = util::hashBytes(row._usrID._begin, row._usrID.size());
+        row._supplyHash  = util::hashBytes(row._supplyID._begin, row._supplyID.size());
+        row._supplyLimit = util::parseInt(supplyLimit._begin, supplyLimit._end);
+
+        Int rowIndex = chunk._rows.size();
+        row._demandBegin = chunk._demandIndex.size();
+        while (!demandList.empty()) {
+            Int demandIndex = _demandIDs.find(demandList.cut(','));
+            if (demandIndex < 0) continue;                          // demandID not in demand file
+            if (demandStamp[demandIndex] == rowIndex) continue;     // listed twice in this row
+            demandStamp[demandIndex] = rowIndex;
+            chunk._demandIndex.push_back(demandIndex);
+        }
+        row._demandEnd = chunk._demandIndex.size();
+
+        chunk._rows.push_back(row);
     }
-    fileStream.close();
 }
 
+/**
+ * @brief usrID supplyID supplyLimit demandID,demandID,... per line, split by ` or ;
+ *        the mapped file is cut at line boundaries into _readThreadCnt chunks parsed in parallel,
+ *        then rows are interned chunk by chunk, so indices do not depend on the thread count
+ */
 void Instance::readSampleFile(string filePath) {
-    std::ifstream fileStream(filePath);
-    string line;
+    MappedFile file(filePath);
     assert(_usrCnt == 0 && _supplyCnt == 0);
     assert(_demandCnt > 0);
     _demand2US.resize(_demandCnt);    // afeter readDemandFile
 
+    const char* begin = file.data();
+    const char* end   = file.data() + file.size();
+
     char splitChar = '-';
+    StrSpan firstLine(begin, end);
+    firstLine = firstLine.cut('\n');
+    if (memchr(firstLine._begin, '`', firstLine.size()) != nullptr) splitChar = '`';
+    if (memchr(firstLine._begin, ';', firstLine.size()) != nullptr) splitChar = ';';
+    if (file.size() > 0 && splitChar == '-') util::showError("No ` or ; in the first line of " + filePath);
+
+    Int chunkCnt = std::min<Int>(_readThreadCnt, file.size() / 4096 + 1);
+    vector<const char*> bound(chunkCnt + 1, end);
+    bound[0] = begin;
+    for (Int i = 1; i < chunkCnt; i++) {
+        const char* pos = std::max(bound[i - 1], begin + file.size() * i / chunkCnt);
+        const char* eol = pos == end ? nullptr : static_cast<const char*>(memchr(pos, '\n', end - pos));
+        bound[i] = eol == nullptr ? end : eol + 1;
+    }
 
-    while (getline(fileStream, line)) {
-        if (genRandom() % 100 > READ_RATE) { // READ_RATE = 10  only read 10% original
-            continue;
+    vector<SampleChunk> chunks(chunkCnt);
+    if (chunkCnt == 1) parseSampleChunk(bound[0], bound[1], splitChar, chunks[0]);
+    else {
+        vector<std::thread> threads;
+        for (Int i = 0; i < chunkCnt; i++) {
+            threads.push_back(std::thread(&Instance::parseSampleChunk, this, bound[i], bound[i + 1], splitChar, std::ref(chunks[i])));
         }
+        for (std::thread& t : threads) t.join();
+    }
 
-        if (splitChar == '-') {
-            if (line.find("`") != string::npos) splitChar = '`';
-            if (line.find(";") != string::npos) splitChar = ';';
-            assert(splitChar != '-');
-        }
+    for (const SampleChunk& chunk : chunks) {
+        for (const SampleChunk::Row& row : chunk._rows) addSampleRow(chunk, row);
+    }
 
+    if (DEBUG && false) displayDemand2US();
+}
 
-        vector<string> sampleData = util::splitStr(line, splitChar);
-        assert(sampleData.size() == 4);
-        string usrID = sampleData.at(0), supplyID = sampleData.at(1);
-        
-        if (!haveUsr(usrID))       addUsr(usrID);
-        if (!haveSupply(supplyID)) addSupply(supplyID);
-
-        Int usrIndex    = getUsrIndex(usrID);
-        Int supplyIndex = getSupplyIndex(supplyID);
-
-        if (util::isFound(supplyIndex, _usrSupply.at(usrIndex))) {
-            util::showWarning("Duplicate UsrID: " + sampleData.at(0) + " and supplyID: " + sampleData.at(1)); 
-        } 
-        else {
-
-            // <usrIndex, supplyIndex> -> _tableCnt
-            _usrSupply.at(usrIndex).push_back(supplyIndex);
-            _usrDemand.at(usrIndex).push_back(_tableCnt);
-
-            assert(_usrSupply.at(usrIndex).size() == _usrDemand.at(usrIndex).size());
-            
-            Int supplyLimit = std::stoll(sampleData.at(2));
-            vector<string> demandList = util::splitStr(sampleData.at(3), ',');
-            vector<Int>    curDemand;
-
-            curDemand.push_back(supplyLimit);
-            Set<Int> visitedDemandIndex;
-            for (string demandID : demandList) {
-                if (!haveDemand(demandID)) {
-                    // util::showWarning("DemandID: " + demandID + " haven't appear before !!!");
-                    continue;
-                }
-                Int demandIndex = getDemandIndex(demandID);
-                if (visitedDemandIndex.count(demandIndex) > 0) continue;
-                visitedDemandIndex.insert(demandIndex);
-
-                curDemand.push_back(demandIndex);
-                _demand2US.at(demandIndex).push_back(std::make_pair(usrIndex, supplyIndex));        // ??? multi add
-            }
+void Instance::addSampleRow(const SampleChunk& chunk, const SampleChunk::Row& row) {
+    bool inserted;
+    Int usrIndex    = _usrIDs.intern(row._usrID, row._usrHash, inserted);
+    if (inserted) addUsr();
+    Int supplyIndex = _supplyIDs.intern(row._supplyID, row._supplyHash, inserted);
+    if (inserted) addSupply();
 
-            _demandTable.push_back(curDemand);
-            _tableCnt++;
-            assert(_tableCnt == _demandTable.size());
-        }
+    if (!_usrSupplyKey.insert(((uint64_t) usrIndex << 32) | (uint64_t) supplyIndex).second) {
+        util::showWarning("Duplicate UsrID: " + row._usrID.str() + " and supplyID: " + row._supplyID.str());
+        return;
     }
 
-    if (DEBUG && false) displayDemand2US();
-}
+    // <usrIndex, supplyIndex> -> _tableCnt
+    _usrSupply.at(usrIndex).push_back(supplyIndex);
+    _usrDemand.at(usrIndex).push_back(_tableCnt);
+    _rowUsr.push_back(usrIndex);
+    _rowSupply.push_back(supplyIndex);
 
-bool Instance::haveVar(Int usrIndex, Int supplyIndex, Int demandIndex) const {
-    assert(usrIndex < _usrCnt);
-    assert(supplyIndex < _supplyCnt);
-    assert(demandIndex < _demandCnt);
-    string queryStr = "U" + to_string(usrIndex) + "S" + to_string(supplyIndex) + "D" + to_string(demandIndex);
-    return haveVar(queryStr);
+    assert(_usrSupply.at(usrIndex).size() == _usrDemand.at(usrIndex).size());
+
+    vector<Int> curDemand;
+    curDemand.push_back(row._supplyLimit);
+    for (size_t i = row._demandBegin; i < row._demandEnd; i++) {
+        Int demandIndex = chunk._demandIndex[i];
+        _demand2US.at(demandIndex).push_back(std::make_pair(_tableCnt, (Int) curDemand.size()));
+        curDemand.push_back(demandIndex);
+    }
+
+    _rowVarBase.push_back(_slotVar.size());
+    _slotVar.resize(_slotVar.size() + curDemand.size() - 1, Variable::undef);
+    _demandTable.push_back(curDemand);
+    _tableCnt++;
+    assert(_tableCnt == _demandTable.size());
 }
 
-void Instance::addVar(string queryStr) {
-    if (JUDGE) assert(!haveVar(queryStr));
-    // if (DEBUG) strMap.insert(std::make_pair(varCnt, queryStr)); 
-    _varMap.insert(std::make_pair(queryStr, _varCnt));
-    _varCnt++;
+Variable Instance::getVar(Int tableRow, Int pos) {
+    assert(tableRow < _tableCnt);
+    assert(pos > 0 && pos < (Int) _demandTable[tableRow].size());
+    Variable& var = _slotVar[varSlot(tableRow, pos)];
+    if (var == Variable::undef) {
+        var = _varCnt;
+        _varCnt++;
+    }
+    return var;
 }
 
-Variable Instance::getVar(Int usrIndex, Int supplyIndex, Int demandIndex) {
-    assert(usrIndex < _usrCnt);
-    assert(supplyIndex < _supplyCnt);
-    assert(demandIndex < _demandCnt);
-    string queryStr = "U" + to_string(usrIndex) + "S" + to_string(supplyIndex) + "D" + to_string(demandIndex);
-    if (!haveVar(queryStr)) addVar(queryStr);
-    return _varMap.at(queryStr);
+string Instance::varStr(Int tableRow, Int pos) const {
+    return _usrIDs.key(_rowUsr[tableRow]).str() + " " + _supplyIDs.key(_rowSupply[tableRow]).str() + " "
+         + _demandIDs.key(_demandTable[tableRow][pos]).str();
 }
 
 /**
@@ -176,8 +211,8 @@ void Instance::genUsrSupplyFormula(NIA_Formula& formula) {
     for (Int usrIndex = 0; usrIndex < _usrCnt; usrIndex++) {  // usrIndex
         const vector<Int>& supplyVec = _usrSupply.at(usrIndex);
         for (Int supplySize = supplyVec.size(), i = 0; i < supplySize; i++) {
-            Int supplyIndex = supplyVec.at(i);
-            const vector<Int>& demandVec = _demandTable.at(_usrDemand.at(usrIndex).at(i));
+            Int tableRow = _usrDemand.at(usrIndex).at(i);
+            const vector<Int>& demandVec = _demandTable.at(tableRow);
 
             assert(demandVec.size() > 0);
             if (demandVec.size() == 1) continue;
@@ -187,14 +222,11 @@ void Instance::genUsrSupplyFormula(NIA_Formula& formula) {
             // \sum coef * var <= carNum
             Polynomial poly;
             for (Int demandSize = demandVec.size(), j = 1; j < demandSize; j++) {   // from 1,  at(0) is castNum
-                Int demandIndex = demandVec.at(j);
-
-                Variable var = getVar(usrIndex, supplyIndex, demandIndex);
-                poly += Monomial(var, 1);
+                Variable var = getVar(tableRow, j);
+                poly.addTerm(var, 1);
             }
-            formula.addConstraint(poly, Op::LEQUAL, castNum);
-
             if (DEBUG && true) cout << "UsrSupply:  " << poly << " <= " << castNum << endl;
+            formula.addConstraint(std::move(poly), Op::LEQUAL, castNum);
         }
 
         formula.setVarCnt(_varCnt);
@@ -206,6 +238,7 @@ void Instance::genUsrSupplyFormula(NIA_Formula& formula) {
  * 
  */
 void Instance::genDemandLimitFormula(NIA_Formula& formula, Int queryDemandIndex) {
+    _demandConsIndex.assign(_demandCnt, undef);
     for (Int demandIndex = 0; demandIndex < _demandCnt; demandIndex++) {
         if (demandIndex == queryDemandIndex) continue;
 
@@ -213,10 +246,10 @@ void Instance::genDemandLimitFormula(NIA_Formula& formula, Int queryDemandIndex)
         Polynomial poly;
         Int polySize = 0;
         for (Int demandSize = demandVec.size(), i = 0; i < demandSize; i++) {
-            Int usrIndex    = demandVec.at(i).first;
-            Int supplyIndex = demandVec.at(i).second;
-            if (JUDGE) assert(haveVar(usrIndex, supplyIndex, demandIndex));
-            poly += Monomial(getVar(usrIndex, supplyIndex, demandIndex), 1);
+            Int tableRow = demandVec.at(i).first;
+            Int pos      = demandVec.at(i).second;
+            if (JUDGE) assert(haveVar(tableRow, pos) && _demandTable.at(tableRow).at(pos) == demandIndex);
+            poly.addTerm(getVar(tableRow, pos), 1);
             polySize++;
         }
         // sum var >= _demandValue.at(demandIndex);
@@ -227,26 +260,27 @@ void Instance::genDemandLimitFormula(NIA_Formula& formula, Int queryDemandIndex)
             continue;
         }
 
-        formula.addConstraint(poly, Op::GEQUAL, limit);
+        _demandConsIndex.at(demandIndex) = formula.getConsCnt();
         if (DEBUG && true) cout << "DemandLimit:  " << demandIndex << " " << poly << " >= " << limit << endl;
+        formula.addConstraint(std::move(poly), Op::GEQUAL, limit);
     }
     // ??? Need a faster visit, demandSupplied ?
 }
 
 /**
- * @brief 
- * 
+ * @brief ratio constraints poly[0] / poly[1] >= poly[2] / poly[3], kept factored
+ *        poly[0] * poly[3] - poly[1] * poly[2] >= 0 
  */
 void Instance::genMutliLinearFormula(NIA_Formula& formula) {
-    Int needConstraintNum = NIA_NUM;            // 100 3.7 constraint
+    Int needConstraintNum = _niaNum;            // 100 3.7 constraint
     Int niaConsCnt = 0;
     
     while (needConstraintNum-- > 0) {
-        Int querySupplyIndex  = genRandom() % _supplyCnt;
-        Int queryDemandIndex1 = genRandom() % _demandCnt;
-        Int queryDemandIndex2 = genRandom() % _demandCnt;
+        Int querySupplyIndex  = _random.bounded(_supplyCnt);
+        Int queryDemandIndex1 = _random.bounded(_demandCnt);
+        Int queryDemandIndex2 = _random.bounded(_demandCnt);
         while(queryDemandIndex1 == queryDemandIndex2) {
-            queryDemandIndex2 = genRandom() % _demandCnt;
+            queryDemandIndex2 = _random.bounded(_demandCnt);
         }
 
         // poly[0]: sum {usrIndex},  supplyIndex,  demandIndex1
@@ -261,38 +295,34 @@ void Instance::genMutliLinearFormula(NIA_Formula& formula) {
         const vector<Pair<Int, Int> >& demandVec2 = _demand2US.at(queryDemandIndex2);
 
         for (Int vecSize = demandVec1.size(), i = 0; i < vecSize; i++) {
-            Int usrIndex    = demandVec1.at(i).first;
-            Int supplyIndex = demandVec1.at(i).second;
-            if (JUDGE) assert(haveVar(usrIndex, supplyIndex, queryDemandIndex1));
+            Int tableRow = demandVec1.at(i).first;
+            Int pos      = demandVec1.at(i).second;
+            if (JUDGE) assert(haveVar(tableRow, pos));
 
-            poly[2] += Monomial(getVar(usrIndex, supplyIndex, queryDemandIndex1), 1);
-            if (supplyIndex == querySupplyIndex)
-                poly[0] += Monomial(getVar(usrIndex, supplyIndex, queryDemandIndex1), 1);
+            poly[2].addTerm(getVar(tableRow, pos), 1);
+            if (_rowSupply.at(tableRow) == querySupplyIndex)
+                poly[0].addTerm(getVar(tableRow, pos), 1);
         }
 
         for (Int vecSize = demandVec2.size(), i = 0; i < vecSize; i++) {
-            Int usrIndex    = demandVec2.at(i).first;
-            Int supplyIndex = demandVec2.at(i).second;
-            if (JUDGE) assert(haveVar(usrIndex, supplyIndex, queryDemandIndex2));
+            Int tableRow = demandVec2.at(i).first;
+            Int pos      = demandVec2.at(i).second;
+            if (JUDGE) assert(haveVar(tableRow, pos));
 
-            poly[3] += Monomial(getVar(usrIndex, supplyIndex, queryDemandIndex2), 1);
-            if (supplyIndex == querySupplyIndex)
-                poly[1] += Monomial(getVar(usrIndex, supplyIndex, queryDemandIndex2), 1);
+            poly[3].addTerm(getVar(tableRow, pos), 1);
+            if (_rowSupply.at(tableRow) == querySupplyIndex)
+                poly[1].addTerm(getVar(tableRow, pos), 1);
         }
 
         if (DEBUG && false) {
             cout << "p1: " << poly[0] << "\np2: " << poly[1] << "\np3: " << poly[2] << "\np4: " << poly[3] << endl;
-            cout << "p1 * p4: " << (poly[0] * poly[3]) << endl;
-            cout << "p2 * p3: " << (poly[1] * poly[2]) << endl;
-            cout << "p1 * p4 - p2 * p3: " << (poly[0] * poly[3]) - (poly[1] * poly[2]) << endl;
         }
 
-        Polynomial res = (poly[0] * poly[3]) - (poly[1] * poly[2]);
-
-        formula.addConstraint(res, Op::GEQUAL, 0);
+        // no expansion, |poly[0]| * |poly[3]| monomials would be generated
+        formula.addFactoredConstraint(std::move(poly[0]), std::move(poly[3]), std::move(poly[1]), std::move(poly[2]), Op::GEQUAL, 0);
         niaConsCnt++;
         if (DEBUG && false) cout << "NIA:  (" << querySupplyIndex << ", " << queryDemandIndex1 << ", " << queryDemandIndex2 << ") "  
-                                << res << " >= 0" << endl;
+                                << formula.getConsVec().back() << endl;
     }
     if (DEBUG && true) cout << "NIA constraint cnt: " << niaConsCnt << endl;
 }
@@ -304,12 +334,12 @@ void Instance::genObjectiveFunction(NIA_Formula& formula, Int queryDemandIndex)
     const vector<Pair<Int, Int> >& demandVec = _demand2US.at(queryDemandIndex);
 
     for(Int vecSize = demandVec.size(), i = 0; i < vecSize; i++) {
-        Int usrIndex    = demandVec.at(i).first;
-        Int supplyIndex = demandVec.at(i).second;
+        Int tableRow = demandVec.at(i).first;
+        Int pos      = demandVec.at(i).second;
 
-        if (JUDGE) assert(haveVar(usrIndex, supplyIndex, queryDemandIndex));
+        if (JUDGE) assert(haveVar(tableRow, pos));
 
-        poly += Monomial(getVar(usrIndex, supplyIndex, queryDemandIndex), 1);
+        poly.addTerm(getVar(tableRow, pos), 1);
     }
 
     formula.addObjectiveFunction(-poly);
@@ -321,7 +351,7 @@ void Instance::displayDemand2US() const {
     for (Int demandIndex = 0; demandIndex < _demandCnt; demandIndex++) {
         cout << "DemandIndex: " << demandIndex;
         for (Pair<Int, Int> p : _demand2US.at(demandIndex)) {
-            cout << " (" << p.first << ", " << p.second << ")  ";
+            cout << " (" << _rowUsr.at(p.first) << ", " << _rowSupply.at(p.first) << ")  ";
         }
         cout << endl;
     }
@@ -331,9 +361,9 @@ NIA_Formula Instance::genFormula() {
     NIA_Formula res;
     cout << "Model problem\n";
     cout << "usr num | supply num | demand num" << endl;
-    cout << _usrMap.size() << " | " << _supplyMap.size() << " | " << _demandMap.size() << endl;
+    cout << _usrIDs.size() << " | " << _supplyIDs.size() << " | " << _demandIDs.size() << endl;
 
-    Int queryDemandIndex = genRandom() % _demandCnt;
+    Int queryDemandIndex = _random.bounded(_demandCnt);
 
     // Part I. Basic Constraints: Linear
     // 2.1 user-supply:     sum vars <= cast count
@@ -348,8 +378,54 @@ NIA_Formula Instance::genFormula() {
     // objective function
     genObjectiveFunction(res, queryDemandIndex);
 
+    res.setVarCnt(_varCnt);
+    genVarNames(res);
+
     // return std::move(res);
     return res;
 }
 
+void Instance::genVarNames(NIA_Formula& formula) const {
+    vector<string> varNames(_varCnt);
+    for (Int tableRow = 0; tableRow < _tableCnt; tableRow++) {
+        for (Int demandSize = _demandTable[tableRow].size(), pos = 1; pos < demandSize; pos++) {
+            if (haveVar(tableRow, pos)) varNames.at(_slotVar[varSlot(tableRow, pos)]) = varStr(tableRow, pos);
+        }
+    }
+    formula.setVarNames(varNames);
+}
+
+/**
+ * @brief genFormula without a query: the demand limit of every demand is kept and there is no objective
+ *        same random draws as genFormula, so genQueryFormula(core, q) equals genFormula() whenever it picks q
+ */
+NIA_Formula Instance::genCoreFormula() {
+    NIA_Formula res;
+    cout << "Model problem (core of all queries)\n";
+    cout << "usr num | supply num | demand num" << endl;
+    cout << _usrIDs.size() << " | " << _supplyIDs.size() << " | " << _demandIDs.size() << endl;
+
+    _random.bounded(_demandCnt);            // query pick of genFormula, keeps the NIA constraints the same
+
+    genUsrSupplyFormula(res);
+    genDemandLimitFormula(res, undef);
+    genMutliLinearFormula(res);
+
+    res.setVarCnt(_varCnt);
+    genVarNames(res);
+    return res;
+}
+
+/**
+ * @brief relax the demand limit of queryDemandIndex in a copy of the core and maximize what it is supplied
+ *        valid for the core of the last genCoreFormula()
+ */
+NIA_Formula Instance::genQueryFormula(const NIA_Formula& core, Int queryDemandIndex) {
+    assert(queryDemandIndex >= 0 && queryDemandIndex < _demandCnt);
+    NIA_Formula res(core);
+    if (_demandConsIndex.at(queryDemandIndex) != undef) res.removeConstraint(_demandConsIndex.at(queryDemandIndex));
+    genObjectiveFunction(res, queryDemandIndex);
+    return res;
+}
+
 } // namespace LS_NIA
\ No newline at end of file
@@ -1,14 +1,20 @@
 #include "lsearch.hpp"
+#include "portfolio.hpp"
+#include "presolve.hpp"
 
 namespace LS_NIA {
 
+LsSolver::LsSolver(const NIA_Formula& formula, const Options& options) 
+    : _formula(&formula), _options(options), _random(options._seed, options._randomStream), _startTime(util::getTimePoint()),
+      _sharedIncumbent(nullptr), _presolver(nullptr), _threadIndex(0), _importedVersion(0), _lastImproveStep(0) {}
+
 void LsSolver::outputInfo(ostream& out) const {
     out << "#vars: " << _varCnt << endl;
     out << "#cons: " << _consCnt << endl;
 }
 
 bool LsSolver::checkOffFlag() const {
-    if (_options._timeOff && util::getSeconds(startTime) > _options._maxTime && _curStep % 100 == 0) {
+    if (_options._timeOff && util::getSeconds(_startTime) > _options._maxTime && _curStep % 100 == 0) {
         if (DEBUG) cout << "Time off with limit: " << _options._maxTime << endl;
         return true;
     }
@@ -20,9 +26,22 @@ bool LsSolver::checkOffFlag() const {
     return false;
 }
 
+void LsSolver::getBestValues(vector<Int>& values) const {
+    values.resize(_varCnt);
+    for (Variable var = Variable::start; var != _varCnt; var++) values[var] = _bestAssignment.getVal(var);
+}
+
 void LsSolver::displayOffInfo() const {
+    Float seconds = util::getSeconds(_startTime);
     cout << "#step: " << _curStep << endl;
-    cout << "#time: " << util::getSeconds(startTime) << endl;
+    cout << "#time: " << seconds << endl;
+    if (seconds > 0) cout << "#step/s: " << (Float) _curStep / seconds << endl;
+}
+
+void LsSolver::displayResult() const {
+    if (!_options._printResult) return;
+    displayOffInfo();
+    displayBestSolution();
 }
 
 void LsSolver::displayBestSolution() const {
@@ -33,7 +52,14 @@ void LsSolver::displayBestSolution() const {
         cout << " ***** UNSAT *****    Best Unsat Cons Num: " << _bestUnSatConsNum << endl;
     }
     cout << "Best Value: " << _bestObjectiveValue << endl;
-    cout << " ***** Best Assignment ******\n" << _bestAssignment << endl;
+    cout << " ***** Best Assignment ******\n";
+    if (_presolver != nullptr) {
+        vector<Int> values;
+        getBestValues(values);
+        _presolver->displayAssignment(cout, values);
+    }
+    else cout << _bestAssignment;
+    cout << endl;
     if (_bestUnSatConsNum == 0)
         cout << "ObjectiveFuntion Value: " << _bestObjectiveValue << endl;
     else cout << "ObjectiveFuntion Value: inf" << endl;
@@ -44,7 +70,7 @@ void LsSolver::displayObjectiveAssignment(bool onlyUnBounded) const {
 
     const Polynomial& poly = _formula->getObjectiveFunction();
     Int cnt = 0, endlCnt = 6;
-    for (const Monomial& mono : poly.getMonoVec()) {
+    for (const MonomialRef& mono : poly.getMonoVec()) {
         for (const Variable& var : mono.getVars()) {
             if (onlyUnBounded) {
                 if (_assignment.getVal(var) < _assignment.getUB(var)) {
@@ -79,7 +105,7 @@ void LsSolver::displayUsefulBestAssignment() const {
     cout << " ***** Useful Objective Assignment Begin *****\n";
     const Polynomial& poly = _formula->getObjectiveFunction();
     Int cnt = 0, endlCnt = 6;
-    for ( const Monomial& mono : poly.getMonoVec()) {
+    for (const MonomialRef& mono : poly.getMonoVec()) {
         for (const Variable& var : mono.getVars()) {
             cout << var << ": " << _assignment.getVal(var) << " [" << _assignment.getLB(var) << ", " << _assignment.getUB(var)  << "]" << "\t";
             if (++cnt % endlCnt == 0) cout << endl;
@@ -100,48 +126,155 @@ void LsSolver::displayUsefulBestAssignment() const {
 void LsSolver::initSolver() {
     _varCnt  = _formula->getVarCnt();
     _consCnt = _formula->getConsCnt();
+    _unSatConstraint.init(_consCnt);
+    _slackConstraint.init(_consCnt);
+    _visitedCons.init(_consCnt);
+    _operatorPool.init(_varCnt);
 
     initObjectiveVars();
     initAssignment();
+    _curObjectiveValue = calcPolyValue(_formula->getObjectiveFunction());
+    initUnBoundedObjVars();
     initConsValue();
     initConsWeight();
     initConsVarInfo();
+    initConsTermInfo();
+    initVarKindSlot();
     initConsCoef();
     initTabuStep();
     initDebugVar();         // for DEBUG
 }
 
+/**
+ * @brief objective vars and their dense coefficients, the search only handles a linear objective
+ */
 void LsSolver::initObjectiveVars() {
     _objectiveVars.clear();
+    _objCoefOnVar.assign(_varCnt, 0);
+    _objectiveVarSet.init(_varCnt);
+    _unBoundedObjVars.init(_varCnt);
     const Polynomial& objectiveFunction = _formula->getObjectiveFunction();
 
-    for (const Monomial& mono : objectiveFunction.getMonoVec()) {
+    for (const MonomialRef& mono : objectiveFunction.getMonoVec()) {
+        if (mono.getVars().size() != 1) util::showError("Objective function is not linear");
         for (const Variable& var : mono.getVars()) {
             _objectiveVars.push_back(var);
+            _objCoefOnVar[var] += mono.getCoef();
+            _objectiveVarSet.insert(var);
         }
     }
 }
 
 void LsSolver::initAssignment() {
-    if (_options._greedyInit) {
-        // not implemented yet
-        assert(false);
-    } 
-    else {  // assign every var to 0;
-        _assignment.allocateAuxiliaryMemory(_varCnt);
-        for (Variable var = Variable::start; var != _varCnt; var++) {
-            _assignment.valAt(var) = 0;
-        }
+    // assign every var to 0;
+    _assignment.allocateAuxiliaryMemory(_varCnt);
+    for (Variable var = Variable::start; var != _varCnt; var++) {
+        _assignment.valAt(var) = 0;
     }
 
     initAssignmentBound();
+    if (!_initValues.empty()) {
+        if ((Int) _initValues.size() != _varCnt) util::showError("Initial values for " + to_string(_initValues.size()) + " vars, formula has " + to_string(_varCnt));
+        for (Variable var = Variable::start; var != _varCnt; var++) {
+            _assignment.valAt(var) = std::min(std::max(_initValues[var], _assignment.getLB(var)), _assignment.getUB(var));
+        }
+    }
+    else if (_options._greedyInit) initGreedyAssignment();
     initBestAssignment();
 }
 
+/**
+ * @brief constructive start for allocation models, from the all 0 assignment
+ *        demand rows (linear >=) are filled in order of scarcity, capacity rows (linear <=) are never exceeded
+ *        scarcity = what the vars of a demand can still offer - its deficit, smallest first
+ *        inside a demand the var with the largest residual capacity is raised first, max heap with lazy updates
+ *        nonlinear constraints are left to the search
+ */
+void LsSolver::initGreedyAssignment() {
+    const vector<Constraint>& consVec = _formula->getConsVec();
+
+    vector<Float> residual(_consCnt, 0);                        // limit - value of the linear <= constraints
+    vector<vector<Pair<Int, Float> > > capacityCons(_varCnt);   // .at(var) = (consIndex, coef > 0) of linear <= constraints
+    vector<Int> demandCons;
+    for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
+        const Constraint& cons = consVec[consIndex];
+        if (!cons.isLinear()) continue;
+        if (cons.getOp() == Op::LEQUAL) {
+            residual[consIndex] = cons.getLimit() - calcConsValue(cons);
+            for (const MonomialRef& mono : cons.getMonoVec()) {
+                if (mono.getCoef() > 0) capacityCons[mono.getVars()[0]].push_back(Pair<Int, Float>(consIndex, mono.getCoef()));
+            }
+        }
+        else if (cons.getOp() == Op::GEQUAL) demandCons.push_back(consIndex);
+    }
+
+    // how far var can be raised without breaking a capacity row or its upper bound
+    auto varCapacity = [&](const Variable& var) -> Int {
+        Int capacity = _assignment.getUB(var) - _assignment.getVal(var);
+        for (const Pair<Int, Float>& p : capacityCons[var]) {
+            capacity = std::min(capacity, (Int) std::floor(residual[p.first] / p.second));
+        }
+        return std::max<Int>(capacity, 0);
+    };
+
+    vector<Pair<Float, Int> > order;                           // (scarcity, consIndex)
+    for (Int consIndex : demandCons) {
+        const Constraint& cons = consVec[consIndex];
+        Float supply = 0;
+        for (const MonomialRef& mono : cons.getMonoVec()) {
+            if (mono.getCoef() > 0) supply += mono.getCoef() * varCapacity(mono.getVars()[0]);
+        }
+        order.push_back(Pair<Float, Int>(supply - (cons.getLimit() - calcConsValue(cons)), consIndex));
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Pair<Float, Int>& a, const Pair<Float, Int>& b) { return a.first < b.first; });
+
+    Int filledCnt = 0;
+    std::priority_queue<Pair<Int, Int> > heap;                 // (capacity when pushed, index of the mono in the demand)
+    for (const Pair<Float, Int>& p : order) {
+        const Constraint&        cons  = consVec[p.second];
+        MonomialRange monos = cons.getMonoVec();
+        Float deficit = cons.getLimit() - calcConsValue(cons);  // vars may be shared with demands filled before
+        if (deficit <= 0) { filledCnt++; continue; }
+
+        heap = std::priority_queue<Pair<Int, Int> >();
+        for (Int i = 0, size = monos.size(); i < size; i++) {
+            if (monos[i].getCoef() <= 0) continue;
+            Int capacity = varCapacity(monos[i].getVars()[0]);
+            if (capacity > 0) heap.push(Pair<Int, Int>(capacity, i));
+        }
+
+        while (deficit > 0 && !heap.empty()) {
+            Pair<Int, Int> top = heap.top();
+            heap.pop();
+            Variable var      = monos[top.second].getVars()[0];
+            Float    coef     = monos[top.second].getCoef();
+            Int      capacity = varCapacity(var);
+            if (capacity != top.first) {            // stale, another var used a shared capacity row
+                if (capacity > 0) heap.push(Pair<Int, Int>(capacity, top.second));
+                continue;
+            }
+
+            Int delta = std::min(capacity, (Int) std::ceil(deficit / coef));
+            _assignment.valAt(var) += delta;
+            deficit -= coef * delta;
+            for (const Pair<Int, Float>& c : capacityCons[var]) residual[c.first] -= c.second * delta;
+        }
+        if (deficit <= 0) filledCnt++;
+    }
+
+    if (DEBUG) cout << "Greedy init: " << filledCnt << " / " << demandCons.size() << " demand constraints filled" << endl;
+}
+
 void LsSolver::initAssignmentBound() {
     for (Variable var = Variable::start; var != _varCnt; var++) {
         if (JUDGE) assert(_assignment.valAt(var) == 0);     // _options.greedyInit = false
         _assignment.lbAt(var) = 0;                          // every variable >= 0
+        _assignment.ubAt(var) = DUMMY_MAX_INT;              // unbounded unless in a <= constraint
+        if (_formula->hasVarBounds()) {
+            _assignment.lbAt(var) = std::max<Int>(_formula->getVarLB(var), 0);
+            _assignment.ubAt(var) = _formula->getVarUB(var);
+        }
     }
 
     const vector<Constraint>& consVec = _formula->getConsVec();
@@ -155,14 +288,24 @@ void LsSolver::initAssignmentBound() {
         else if (op == Op::EQUAL || op == Op::UNDEF) util::showError("Un except Op in initAssignmentBound");
 
         //  <= constraint
-        for (Monomial mono : cons.getMonoVec()) {
-            for (Variable var : mono.getVars()) {
-                // _assignment.at(var).updateUB(limit);    // correct with x >= 0 
-                _assignment.ubAt(var) = limit;    // correct with x >= 0 
-            }
+        // sum coef * x <= limit with every coef > 0 and x >= 0 gives x <= limit / coef, as Presolver::propagateRow
+        // a mixed sign or nonlinear row bounds none of its vars
+        bool positiveLinear = cons.isLinear();
+        for (const MonomialRef& mono : cons.getMonoVec()) positiveLinear = positiveLinear && mono.getCoef() > 0;
+        if (!positiveLinear) continue;
+        for (const MonomialRef& mono : cons.getMonoVec()) {
+            Variable var = mono.getVars()[0];
+            Int      ub  = (Int) std::floor(limit / mono.getCoef());
+            // never below lb, an infeasible row is left to the search
+            _assignment.ubAt(var) = std::max(_assignment.getLB(var), std::min(_assignment.getUB(var), ub));
         }
     }
 
+    // explicit bounds may have lb > 0
+    for (Variable var = Variable::start; var != _varCnt; var++) {
+        _assignment.valAt(var) = std::max(_assignment.getVal(var), _assignment.getLB(var));
+    }
+
     if (DEBUG && _options._printStep && false) {
         cout << "Init Assignment:\n" << _assignment; 
         cout << " ***** Done ****** " << endl;
@@ -180,33 +323,34 @@ void LsSolver::initBestAssignment() {
 void LsSolver::initConsValue() {
     _consValue.clear();
     _consValue.resize(_consCnt);
+    _consLimit.resize(_consCnt);
+    _consDir.resize(_consCnt);
     assert(_unSatConstraint.size() == 0);
+    _slackConstraint.clear();
 
     const vector<Constraint>& consVec = _formula->getConsVec();
     if (JUDGE) assert(consVec.size() == _consCnt);
     for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
         const Constraint& cons = consVec[consIndex];
-        _consValue[consIndex] = calcConsValue(cons);
+        Op op = cons.getOp();
+        if (op == Op::EQUAL || op == Op::UNDEF) util::showError("UnExcept Op::EQUAL in our instance");
 
-        Op  op    = cons.getOp();
-        Int limit = cons.getLimit();
-        Int val   = _consValue[consIndex];
+        _consDir[consIndex]   = op == Op::LEQUAL ? 1 : -1;
+        _consLimit[consIndex] = _consDir[consIndex] * cons.getLimit();
+        _consValue[consIndex] = util::narrowNum(_consDir[consIndex] * calcConsValue(cons));
 
-        if (!judgeLimitOpVal(limit, op, val)) addUnSatConstraint(consIndex);
+        if (!isSatValue(consIndex, _consValue[consIndex])) addUnSatConstraint(consIndex);
+        updateSlackConstraint(consIndex);
     }
 }
 
-void LsSolver::initTabuStep() {
-    _tabuStepOnVar.resize(_varCnt, 0);
+void LsSolver::initUnBoundedObjVars() {
+    _unBoundedObjVars.clear();
+    for (Int var : _objectiveVarSet) updateUnBoundedObjVar(Variable(var));
 }
 
-bool LsSolver::judgeLimitOpVal(Int limit, Op op, Int val) const {
-
-    if (op == Op::GEQUAL && val < limit) return false;
-    else if (op == Op::LEQUAL && val > limit) return false;
-    else if (op == Op::EQUAL || op == Op::UNDEF) util::showError("UnExcept Op::EQUAL in our instance");
-
-    return true;
+void LsSolver::initTabuStep() {
+    _tabuStepOnVar.resize(_varCnt, 0);
 }
 
 void LsSolver::initConsWeight() {
@@ -217,64 +361,208 @@ void LsSolver::initConsWeight() {
 }
 
 /**
- * @brief init _consVarSet
- *             _var2ConsIndex
- * 
+ * @brief init _consSlotBegin _slotVar _slotCons
+ *             _varSlotBegin  _varSlot
+ *        every (consIndex, var) pair gets a dense slot, slots of a cons sorted by var
  */
 void LsSolver::initConsVarInfo() {
     assert(_formula->getConsCnt() == _consCnt);
 
-    _var2ConsIndex.clear();
-    _var2ConsIndex.resize(_varCnt);
-    for (Int i = 0; i < _varCnt; i++) _var2ConsIndex[i].clear();
-
-    _consVarSet.clear();
-    _consVarSet.resize(_consCnt);
-    for (Int i = 0; i < _consCnt; i++) _consVarSet[i].clear();
+    _consSlotBegin.clear();
+    _consSlotBegin.reserve(_consCnt + 1);
+    _slotVar.clear();
+    _slotCons.clear();
 
     const vector<Constraint>& consVec = _formula->getConsVec();
+    vector<Variable> consVars;
     for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
         const Constraint& cons = consVec[consIndex];
-        for (const Monomial& mono : cons.getMonoVec()) {
+        consVars.clear();
+        for (const MonomialRef& mono : cons.getMonoVec()) {
             for (const Variable& var : mono.getVars()) {
                 if (JUDGE) assert(var < _varCnt);
-
-                if (!util::isFound(consIndex, _var2ConsIndex[var]))
-                    _var2ConsIndex[var].push_back(consIndex);
-                _consVarSet[consIndex].insert(var);
+                consVars.push_back(var);
+            }
+        }
+        for (const Polynomial& factor : cons.getFactors()) {
+            for (const MonomialRef& mono : factor.getMonoVec()) {
+                for (const Variable& var : mono.getVars()) {
+                    if (JUDGE) assert(var < _varCnt);
+                    consVars.push_back(var);
+                }
             }
         }
+        std::sort(consVars.begin(), consVars.end());
+        consVars.erase(std::unique(consVars.begin(), consVars.end()), consVars.end());
+
+        _consSlotBegin.push_back(_slotVar.size());
+        for (const Variable& var : consVars) {
+            _slotVar.push_back(var);
+            _slotCons.push_back(consIndex);
+        }
+    }
+    _consSlotBegin.push_back(_slotVar.size());
+
+    Int slotCnt = _slotVar.size();
+    _varSlotBegin.assign(_varCnt + 1, 0);
+    for (Int slot = 0; slot < slotCnt; slot++) _varSlotBegin[_slotVar[slot] + 1]++;
+    for (Int i = 0; i < _varCnt; i++) _varSlotBegin[i + 1] += _varSlotBegin[i];
+
+    _varSlot.resize(slotCnt);
+    vector<Int> fillPos(_varSlotBegin.begin(), _varSlotBegin.end() - 1);
+    for (Int slot = 0; slot < slotCnt; slot++) {        // slot order is consIndex order
+        _varSlot[fillPos[_slotVar[slot]]++] = slot;
     }
 }
 
+/**
+ * @brief index every monomial of degree >= 2 by the slots of its vars, built once from the formula
+ *        updateConsInfo and isFactor visit only the terms of one slot
+ */
+void LsSolver::initConsTermInfo() {
+    _termSlotBegin.assign(1, 0);
+    _termSlot.clear();
+    _termCoef.clear();
+
+    const vector<Constraint>& consVec = _formula->getConsVec();
+    for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
+        const Constraint& cons = consVec[consIndex];
+        if (cons.isFactored() || cons.isLinear()) continue;
+        for (const MonomialRef& mono : cons.getMonoVec()) {
+            if (mono.getVars().size() < 2) continue;
+            for (const Variable& var : mono.getVars()) _termSlot.push_back(getSlot(consIndex, var));
+            _termSlotBegin.push_back(_termSlot.size());
+            _termCoef.push_back(_consDir[consIndex] * util::toNum(mono.getCoef()));
+        }
+    }
+
+    Int termCnt = _termCoef.size();
+    Int slotCnt = _slotVar.size();
+    _slotTermBegin.assign(slotCnt + 1, 0);
+    for (Int term = 0; term < termCnt; term++) {
+        for (Int i = _termSlotBegin[term]; i < _termSlotBegin[term + 1]; i++) {
+            if (i == _termSlotBegin[term] || _termSlot[i] != _termSlot[i - 1]) _slotTermBegin[_termSlot[i] + 1]++;
+        }
+    }
+    for (Int slot = 0; slot < slotCnt; slot++) _slotTermBegin[slot + 1] += _slotTermBegin[slot];
+
+    _slotTerm.resize(_slotTermBegin[slotCnt]);
+    vector<Int> fillPos(_slotTermBegin.begin(), _slotTermBegin.end() - 1);
+    for (Int term = 0; term < termCnt; term++) {
+        for (Int i = _termSlotBegin[term]; i < _termSlotBegin[term + 1]; i++) {
+            if (i == _termSlotBegin[term] || _termSlot[i] != _termSlot[i - 1]) _slotTerm[fillPos[_termSlot[i]]++] = term;
+        }
+    }
+    _pendingSlot.init(slotCnt);
+    _pendingCoef.resize(slotCnt);
+}
+
+/**
+ * @brief group the slots of every var by SlotKind, keeping the _varSlot order inside a group
+ *        a slot of a POLYNOMIAL constraint is linear if var is in none of its terms
+ */
+void LsSolver::initVarKindSlot() {
+    Int slotCnt = _slotVar.size();
+    vector<Int> slotKind(slotCnt);
+    for (Int slot = 0; slot < slotCnt; slot++) {
+        if (_formula->getConsVec()[_slotCons[slot]].isFactored()) slotKind[slot] = FACTORED_SLOT;
+        else if (_slotTermBegin[slot] != _slotTermBegin[slot + 1]) slotKind[slot] = NONLINEAR_SLOT;
+        else slotKind[slot] = LINEAR_SLOT;
+    }
+
+    _varKindSlotBegin.assign(_varCnt * SLOT_KIND_CNT + 1, 0);
+    for (Int slot = 0; slot < slotCnt; slot++) _varKindSlotBegin[_slotVar[slot] * SLOT_KIND_CNT + slotKind[slot] + 1]++;
+    for (Int i = 0; i < _varCnt * SLOT_KIND_CNT; i++) _varKindSlotBegin[i + 1] += _varKindSlotBegin[i];
+
+    _varKindSlot.resize(slotCnt);
+    vector<Int> fillPos(_varKindSlotBegin.begin(), _varKindSlotBegin.end() - 1);
+    for (Int slot : _varSlot) _varKindSlot[fillPos[_slotVar[slot] * SLOT_KIND_CNT + slotKind[slot]]++] = slot;
+}
+
 void LsSolver::initUnSatConstraint() {
     // implemented in initConstraintValue()
 }
 
 /**
- * @brief init _consCoefOnVar
- *             _consFreeOnVar
+ * @brief init _slotCoef, one pass over the monomials of every constraint
+ *             _factorValue _slotFactorCoef for factored constraints
  *        assert(coefficient * var + freeTerm == value)
  *        p * x + q = v
+ *        coefficients take the sign of _consDir, a negated factored constraint swaps its products: -(f0 * f1 - f2 * f3) = f2 * f3 - f0 * f1
  */
 void LsSolver::initConsCoef() {
-    _consCoefOnVar.resize(_consCnt);
-    // _consFreeOnVar.resize(_consCnt);
-    Variable var;
+    _slotCoef.assign(_slotVar.size(), 0);
+    _slotFactorBase.assign(_slotVar.size(), -1);
+    _slotFactorCoef.clear();
+    _consFactorBase.assign(_consCnt, -1);
+    _factorValue.clear();
+
+    const Int factorCnt = Constraint::factorCnt;
     for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
-        const Constraint& cons = _formula->getConsVec().at(consIndex);
-        // bool  linearFlag = cons.isLinear();
-        for (const unsigned& varVal : _consVarSet.at(consIndex)) {
-            var = varVal;
-            if (JUDGE) assert(_consCoefOnVar.at(consIndex).find(var) == _consCoefOnVar.at(consIndex).end());
-            // if (JUDGE) assert(_consFreeOnVar.at(consIndex).find(var) == _consFreeOnVar.at(consIndex).end());
-            Float coef  = calcVarCoefOnPoly(cons.getPolynomial(), var);
-
-            _consCoefOnVar[consIndex].insert(std::make_pair(var, coef));
+        const Constraint& cons = _formula->getConsVec()[consIndex];
+        if (cons.isFactored()) {
+            _consFactorBase[consIndex] = _factorValue.size();
+            for (Int slot = _consSlotBegin[consIndex]; slot < _consSlotBegin[consIndex + 1]; slot++) {
+                _slotFactorBase[slot] = _slotFactorCoef.size();
+                _slotFactorCoef.resize(_slotFactorCoef.size() + factorCnt, 0);
+            }
+            for (Int pos = 0; pos < factorCnt; pos++) {
+                Int k = _consDir[consIndex] > 0 ? pos : pos ^ 2;
+                const Polynomial& factor = cons.getFactors()[k];
+                _factorValue.push_back(util::narrowNum(calcPolyValue(factor)));
+                for (const MonomialRef& mono : factor.getMonoVec()) {
+                    Int slot = getSlot(consIndex, mono.getVars().front());
+                    _slotFactorCoef[_slotFactorBase[slot] + pos] += util::toNum(mono.getCoef());
+                }
+            }
+            // var in both factors of one product is not linear on var
+            for (Int slot = _consSlotBegin[consIndex]; slot < _consSlotBegin[consIndex + 1]; slot++) {
+                const Num* coef = &_slotFactorCoef[_slotFactorBase[slot]];
+                if ((coef[0] != 0 && coef[1] != 0) || (coef[2] != 0 && coef[3] != 0))
+                    util::showError("Var appears in both factors of a product in factored constraint");
+            }
+            if (JUDGE) assert(_consValue[consIndex] == _consDir[consIndex] * calcConsValue(cons));
+            continue;
+        }
+
+        for (const MonomialRef& mono : cons.getMonoVec()) {
+            const VarSpan& vars = mono.getVars();
+            for (Int size = vars.size(), i = 0; i < size; i++) {
+                if (i > 0 && vars[i] == vars[i - 1]) continue;      // vars are sorted
+                Num& coef = _slotCoef[getSlot(consIndex, vars[i])];
+                coef = util::narrowNum(coef + _consDir[consIndex] * calcVarCoefOnMono(mono, vars[i]));
+            }
+        }
+        if (JUDGE) {
+            for (Int slot = _consSlotBegin[consIndex]; slot < _consSlotBegin[consIndex + 1]; slot++)
+                assert(_slotCoef[slot] == _consDir[consIndex] * calcVarCoefOnCons(cons, _slotVar[slot]));
         }
     }
 }
 
+/**
+ * @brief coefficient of slot var in a factored constraint
+ *        d(f0 * f1 - f2 * f3) / dx = a0 * f1 + a1 * f0 - a2 * f3 - a3 * f2
+ */
+Num LsSolver::calcFactoredSlotCoef(Int slot) const {
+    const Num* coef   = &_slotFactorCoef[_slotFactorBase[slot]];
+    const Num* factor = &_factorValue[_consFactorBase[_slotCons[slot]]];
+    return util::narrowNum((WideNum) coef[0] * factor[1] + (WideNum) coef[1] * factor[0]
+                           - (WideNum) coef[2] * factor[3] - (WideNum) coef[3] * factor[2]);
+}
+
+/**
+ * @brief slot of var in consIndex, binary search on the sorted slots of the constraint
+ * 
+ */
+Int LsSolver::getSlot(Int consIndex, const Variable& var) const {
+    vector<Variable>::const_iterator first = _slotVar.begin() + _consSlotBegin[consIndex];
+    vector<Variable>::const_iterator last  = _slotVar.begin() + _consSlotBegin[consIndex + 1];
+    vector<Variable>::const_iterator it    = std::lower_bound(first, last, var);
+    if (JUDGE) assert(it != last && *it == var);
+    return it - _slotVar.begin();
+}
+
 void LsSolver::addUnSatConstraint(Int consIndex) {
     if (isUnSatConstraint(consIndex)) return;
 
@@ -292,96 +580,122 @@ bool LsSolver::judgeUnSatConstraint() const {
 
     const vector<Constraint>& consVec = _formula->getConsVec();
     for (Int consIndex = 0; consIndex < _consCnt; consIndex ++) {
-        const Constraint& cons = consVec.at(consIndex);
-        assert(_consValue.at(consIndex) == calcConsValue(cons));
+        const Constraint& cons  = consVec.at(consIndex);
+        WideNum           value = calcConsValue(cons);
+        assert(_consValue.at(consIndex) == _consDir.at(consIndex) * value);
 
         Int  limit = cons.getLimit();
         Int  op    = cons.getOp();
         bool satF  = true;
 
+        // against the formula, not the negated form
         if (op == Op::GEQUAL) {
-            if (_consValue.at(consIndex) < limit) satF = false;
+            if (value < limit) satF = false;
         }
         else if (op == Op::LEQUAL) {
-            if (_consValue.at(consIndex) > limit) satF = false;
+            if (value > limit) satF = false;
         }
         else util::showError("Un Except Op::EQUAL or OP::UNDEF in judgeUnSatConstraint");
 
         assert((satF && !isUnSatConstraint(consIndex)) || (!satF && isUnSatConstraint(consIndex)));
+        assert(isSlackConstraint(consIndex) == (_consValue.at(consIndex) != _consLimit.at(consIndex)));
+    }
+    for (const Variable& var : _objectiveVars) {
+        assert(_unBoundedObjVars.contains(var) == (getVarAssign(var) != getVarUB(var)));
     }
 
     return true;    // false will failed assert previously
 }
 
+/**
+ * @brief full recompute check of the incremental _consValue and _slotCoef
+ * 
+ */
 bool LsSolver::judgeCoefFreeValue() const {
     assert(JUDGE);
     for (Int consIndex = 0; consIndex < _consCnt; consIndex ++) {
         const Constraint& cons = _formula->getConsVec()[consIndex];
-        Float curValue = _consValue[consIndex];
-        Variable var;
-        for (const unsigned& varVal : _consVarSet[consIndex]) {
-            var = varVal;
-            // Float freeTerm = _consFreeOnVar.at(consIndex).at(var);
-            Float coefTerm = _consCoefOnVar.at(consIndex).at(var);
-            Float freeTerm = curValue - coefTerm * getVarAssign(var);
+        Int dir      = _consDir[consIndex];
+        Num curValue = _consValue[consIndex];
+        if (JUDGE && curValue != dir * calcConsValue(cons)) {
+            cout << "Cons [" << consIndex << "]: " << cons << endl;
+            cout << "Value: " << curValue << " calc: " << (Float) (dir * calcConsValue(cons)) << endl;
+        }
+        if (JUDGE) assert(curValue == dir * calcConsValue(cons));
+        for (Int slot = _consSlotBegin[consIndex]; slot < _consSlotBegin[consIndex + 1]; slot++) {
+            Variable var   = _slotVar[slot];
+            Num     coefTerm = getSlotCoef(slot);
+            WideNum freeTerm = curValue - (WideNum) coefTerm * getVarAssign(var);
             // assert(curValue == coefTerm * getVarAssign(var) + freeTerm);
-            if (JUDGE && coefTerm != calcVarCoefOnPoly(cons.getPolynomial(), var)) {
+            if (JUDGE && coefTerm != dir * calcVarCoefOnCons(cons, var)) {
                 cout << "Cons [" << consIndex << "]: " << cons << endl;
                 cout << "Var: " << var << endl;
-                cout << "Coef: " << coefTerm << " calc: " << calcVarCoefOnPoly(cons.getPolynomial(), var) << endl;
-                cout << "Free: " << freeTerm << " calc: " << calcConsValueExVar(cons, var) << endl;
+                cout << "Coef: " << coefTerm << " calc: " << (Float) (dir * calcVarCoefOnCons(cons, var)) << endl;
+                cout << "Free: " << (Float) freeTerm << " calc: " << (Float) (dir * calcConsValueExVar(cons, var)) << endl;
             }
-            if (JUDGE) assert(coefTerm == calcVarCoefOnPoly(cons.getPolynomial(), var));
-            if (JUDGE) assert(freeTerm == calcConsValueExVar(cons, var));
+            if (JUDGE) assert(coefTerm == dir * calcVarCoefOnCons(cons, var));
+            if (JUDGE) assert(freeTerm == dir * calcConsValueExVar(cons, var));
         }
     }
     return true;    // false will failed assert previously
 }
 
-Float LsSolver::calcConsValue(const Constraint& cons) const {
+WideNum LsSolver::calcConsValue(const Constraint& cons) const {
+    if (cons.isFactored()) {
+        const vector<Polynomial>& f = cons.getFactors();
+        return calcPolyValue(f[0]) * calcPolyValue(f[1]) - calcPolyValue(f[2]) * calcPolyValue(f[3]);
+    }
     const Polynomial& poly = cons.getPolynomial();
     return calcPolyValue(poly);
 }
 
-Float LsSolver::calcPolyValue(const Polynomial& poly) const {
+WideNum LsSolver::calcPolyValue(const Polynomial& poly) const {
     if (poly.empty()) return 0;
 
-    Float res = 0;
-    const vector<Monomial>& monoVec = poly.getMonoVec();
-    for (const Monomial& mono : monoVec) {
+    WideNum res = 0;
+    MonomialRange monoVec = poly.getMonoVec();
+    for (const MonomialRef& mono : monoVec) {
         res += calcMonomialValue(mono);
     }
     return res;
 }
 
-Float LsSolver::calcConsValueExVar(const Constraint& cons, const Variable& exVar) const {
-    const Polynomial& poly = cons.getPolynomial();
+WideNum LsSolver::calcConsValueExVar(const Constraint& cons, const Variable& exVar) const {
+    if (cons.isFactored()) {
+        const vector<Polynomial>& f = cons.getFactors();
+        return calcPolyValueExVar(f[0], exVar) * calcPolyValueExVar(f[1], exVar) 
+             - calcPolyValueExVar(f[2], exVar) * calcPolyValueExVar(f[3], exVar);
+    }
+    return calcPolyValueExVar(cons.getPolynomial(), exVar);
+}
+
+WideNum LsSolver::calcPolyValueExVar(const Polynomial& poly, const Variable& exVar) const {
     if (poly.empty()) return 0;
 
-    Float res = 0;
-    const vector<Monomial>& monoVec = poly.getMonoVec();
-    for (const Monomial& mono : monoVec) {
+    WideNum res = 0;
+    MonomialRange monoVec = poly.getMonoVec();
+    for (const MonomialRef& mono : monoVec) {
         res += calcMonomialValueExVar(mono, exVar);
     }
     return res;
 }
 
-Float LsSolver::calcMonomialValue(const Monomial& mono) const {
+WideNum LsSolver::calcMonomialValue(const MonomialRef& mono) const {
     if (mono.empty()) return 0;
 
-    Float res = mono.getCoef();
-    const vector<Variable>& vars = mono.getVars();
+    WideNum res = util::toNum(mono.getCoef());
+    const VarSpan& vars = mono.getVars();
     for (Variable var : vars) {
         res *= getVarAssign(var);
     }
     return res;
 }
 
-Float LsSolver::calcMonomialValueExVar(const Monomial& mono, const Variable& exVar) const {
+WideNum LsSolver::calcMonomialValueExVar(const MonomialRef& mono, const Variable& exVar) const {
     if (mono.empty()) return 0;
 
-    Float res = mono.getCoef();
-    const vector<Variable>& vars = mono.getVars();
+    WideNum res = util::toNum(mono.getCoef());
+    const VarSpan& vars = mono.getVars();
     for (Variable var : vars) {
         if (var == exVar) return 0;
         res *= getVarAssign(var);
@@ -389,23 +703,35 @@ Float LsSolver::calcMonomialValueExVar(const Monomial& mono, const Variable& exV
     return res;
 }
 
-Float LsSolver::calcVarCoefOnPoly(const Polynomial& poly, const Variable& exVar) const {
+WideNum LsSolver::calcVarCoefOnCons(const Constraint& cons, const Variable& exVar) const {
+    if (cons.isFactored()) {
+        const vector<Polynomial>& f = cons.getFactors();
+        WideNum res = 0;
+        for (Int k = 0; k < Constraint::factorCnt; k++) {
+            res += Constraint::factorSign(k) * calcVarCoefOnPoly(f[k], exVar) * calcPolyValue(f[k ^ 1]);
+        }
+        return res;
+    }
+    return calcVarCoefOnPoly(cons.getPolynomial(), exVar);
+}
+
+WideNum LsSolver::calcVarCoefOnPoly(const Polynomial& poly, const Variable& exVar) const {
     if (poly.empty()) return 0;
 
-    Float res = 0;
-    const vector<Monomial>& monoVec = poly.getMonoVec();
-    for (const Monomial& mono : monoVec) {
+    WideNum res = 0;
+    MonomialRange monoVec = poly.getMonoVec();
+    for (const MonomialRef& mono : monoVec) {
         res += calcVarCoefOnMono(mono, exVar);
     }
     return res;
 }
 
-Float LsSolver::calcVarCoefOnMono(const Monomial& mono, const Variable& exVar) const {
+WideNum LsSolver::calcVarCoefOnMono(const MonomialRef& mono, const Variable& exVar) const {
     if (mono.empty()) return 0;
 
-    Float res = mono.getCoef();
-    Float flg = 0;
-    const vector<Variable>& vars = mono.getVars();
+    WideNum res = util::toNum(mono.getCoef());
+    WideNum flg = 0;
+    const VarSpan& vars = mono.getVars();
     for (Variable var : vars) {
         if (var == exVar) flg = 1;
         else res *= getVarAssign(var);
@@ -418,9 +744,9 @@ Float LsSolver::calcVarCoefOnMono(const Monomial& mono, const Variable& exVar) c
  * 
  *      coefTerm * var + freeTerm = consValue
  */
-Pair<Float, Float> LsSolver::clacVarInfoInCons(const Int& consIndex, const Variable& exVar) const {
-    Float coefTerm = _consCoefOnVar[consIndex].at(exVar);
-    Float freeTerm = _consValue[consIndex] - coefTerm * getVarAssign(exVar);
+Pair<Num, WideNum> LsSolver::clacVarInfoInCons(const Int& slot) const {
+    Num     coefTerm = getSlotCoef(slot);
+    WideNum freeTerm = _consValue[_slotCons[slot]] - (WideNum) coefTerm * getVarAssign(_slotVar[slot]);
     return std::make_pair(coefTerm, freeTerm);
 }
 
@@ -431,7 +757,7 @@ bool LsSolver::liftObjectiveFunction() {
     Variable bestVar    = Variable::undef;
     Int      bestVarVal = 0;
 
-    for (const Monomial& mono : objectiveFunction.getMonoVec()) {
+    for (const MonomialRef& mono : objectiveFunction.getMonoVec()) {
         if (JUDGE) assert(mono.getVars().size() == 1);
         for (const Variable& var : mono.getVars()) {        // if size == 1, do not need for-loop
             if (_options._tabuFlag) {
@@ -461,10 +787,7 @@ bool LsSolver::liftObjectiveFunction() {
     }
 
     // do lift
-    if (bestScore > 0) {
-        setVarWithNewVal(bestVar, bestVarVal);
-        return true;
-    }
+    if (bestScore > 0) return setVarWithNewVal(bestVar, bestVarVal);
     return false;
 }
 
@@ -475,8 +798,8 @@ Int LsSolver::liftObjectiveFunctionOnVar(const Variable& var, bool findMax) {
 Int LsSolver::findFeasibleVarValue(const Variable& var, bool findMax) {
     Int res = findMax ? DUMMY_MAX_INT : DUMMY_MIN_INT;      // feasible value, findMax needs min()
 
-    for (Int consIndex : _var2ConsIndex[var]) {
-        Int value = findFeasibleVarValueOnCons(var, consIndex, findMax);
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+        Int value = findFeasibleVarValueOnSlot(_varSlot[i], findMax);
 
         if (value == DUMMY_MIN_INT || value == DUMMY_MAX_INT) continue;
         res = findMax ? std::min(res, value) : std::max(res, value);
@@ -487,42 +810,38 @@ Int LsSolver::findFeasibleVarValue(const Variable& var, bool findMax) {
 }
 
 /**
- * @brief coef * var + otherValue [op] limit
- *        if op is =   return exactValue = (limit - otherValue) / coef
- *        if op is >=  return (coef > 0 ? minValue : maxValue)
- *        if op is <=  return (coef < 0 ? maxValue : minValue)
+ * @brief coef * var + otherValue <= limit, in the negated form of a >= constraint
+ *        return (coef > 0 ? maxValue : minValue)
  */
-Int LsSolver::findFeasibleVarValueOnCons(const Variable& var, const Int consIndex, bool findMax) {
-    const Constraint& cons = _formula->getConsVec()[consIndex];
-    Op    op    = cons.getOp();
-    Float limit = cons.getLimit();      // return is Int  need updated ?
+Int LsSolver::findFeasibleVarValueOnSlot(const Int slot, bool findMax) {
+    Int       consIndex = _slotCons[slot];
+    Variable  var       = _slotVar[slot];
+    Int       limit     = _consLimit[consIndex];
 
-    Float coefTerm = _consCoefOnVar[consIndex][var]; 
-    Float freeTerm = _consValue[consIndex] - coefTerm * getVarAssign(var);
+    Num     coefTerm = getSlotCoef(slot);
+    WideNum freeTerm = _consValue[consIndex] - (WideNum) coefTerm * getVarAssign(var);
 
     // if (coefTerm == 0) return findMax ? _assignment.getUB(var) : _assignment.getLB(var);
-    if (!couldCalc(op, coefTerm, findMax)) 
+    if (!couldCalc(coefTerm, findMax)) 
         return findMax ? DUMMY_MIN_INT : DUMMY_MAX_INT;  // can not find
 
     assert (coefTerm != 0);
-    Float res = (limit - freeTerm) / coefTerm;
+    // floor for max, ceil for min, exact division, out of range values are no bound for the var
+    WideNum res = findMax ? util::floorDiv(limit - freeTerm, coefTerm) : util::ceilDiv(limit - freeTerm, coefTerm);
 
     if (DEBUG && var == _debugVar) {
-        cout << "FreeTerm: " << freeTerm << endl;
-        cout << "Var: " << var << "  In cons: " << cons <<endl;
-        cout << "calc: " << res << endl;
+        cout << "FreeTerm: " << (Float) freeTerm << endl;
+        cout << "Var: " << var << "  In cons: " << _formula->getConsVec()[consIndex] <<endl;
+        cout << "calc: " << (Float) res << endl;
     }
 
-    if (op == Op::EQUAL) util::showError("Not implemented yet");  // EQUAL can not floor or ceil, need judge
-    return findMax ? std::floor(res) : std::ceil(res);      // floor for max, ceil for min    -> Int 
+    if (res >= DUMMY_MAX_INT) return DUMMY_MAX_INT - 1;
+    if (res <= DUMMY_MIN_INT) return DUMMY_MIN_INT + 1;
+    return res;
 }
 
-bool LsSolver::couldCalc(Op op, Int coef, bool findMax) const {
-    if (coef == 0) return false;
-    if (op == Op::EQUAL) return true;
-    bool couldMax = (op == Op::GEQUAL && coef < 0) || (op == Op::LEQUAL && coef > 0);
-
-    return (couldMax && findMax) || (!couldMax && !findMax);
+bool LsSolver::couldCalc(Num coef, bool findMax) const {
+    return coef != 0 && (coef > 0) == findMax;
 }
 
 inline bool LsSolver::checkOperator(Variable var, Int val) const {
@@ -530,37 +849,38 @@ inline bool LsSolver::checkOperator(Variable var, Int val) const {
     if (val == DUMMY_MAX_INT || val == DUMMY_MIN_INT) return false;
     if (val == getVarAssign(var)) return false;
     if (!_assignment.isValid(var, val)) return false;
-    if (_options._tabuFlag && _curStep < _tabuStepOnVar[var]) return false;
+    if (isTabu(var)) return false;
     return true;
 }
 
 void LsSolver::insertOperatorOnCons(const Int consIndex) {
-    const Constraint& cons = _formula->getConsVec()[consIndex];
-    for (const Monomial& mono : cons.getMonoVec()) {
-        for (const Variable& var : mono.getVars()) {
-            Int maxVal = findFeasibleVarValueOnCons(var, consIndex, true);
-            Int minVal = findFeasibleVarValueOnCons(var, consIndex, false);
-
-            // ??????? This is a problem !!!! 
-            // 只插非界限
-            // if (maxVal != DUMMY_MIN_INT) {
-            //     maxVal = std::min(_assignment.getUB(var), maxVal);
-            //     maxVal = std::max(_assignment.getLB(var), maxVal);
-            // }
-            // if (minVal != DUMMY_MAX_INT) {
-            //     minVal = std::min(_assignment.getUB(var), minVal);
-            //     minVal = std::max(_assignment.getLB(var), minVal);
-            // }
-
-            if (checkOperator(var, maxVal)) {
-                if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << maxVal << "   in inOpOnCons" << endl;
-                _operatorPool.push(var, maxVal);
-            }
-            if (checkOperator(var, minVal)) {
-                if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << minVal << "   in inOpOnCons" << endl;
-                _operatorPool.push(var, minVal);
-            }
+    for (Int slot = _consSlotBegin[consIndex]; slot < _consSlotBegin[consIndex + 1]; slot++) {
+        Variable var = _slotVar[slot];
+        Int maxVal = findFeasibleVarValueOnSlot(slot, true);
+        Int minVal = findFeasibleVarValueOnSlot(slot, false);
+
+        // ??????? This is a problem !!!! 
+        // 只插非界限
+        // if (maxVal != DUMMY_MIN_INT) {
+        //     maxVal = std::min(_assignment.getUB(var), maxVal);
+        //     maxVal = std::max(_assignment.getLB(var), maxVal);
+        // }
+        // if (minVal != DUMMY_MAX_INT) {
+        //     minVal = std::min(_assignment.getUB(var), minVal);
+        //     minVal = std::max(_assignment.getLB(var), minVal);
+        // }
+
+        Int vals[2];
+        Int valCnt = 0;
+        if (checkOperator(var, maxVal)) {
+            if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << maxVal << "   in inOpOnCons" << endl;
+            vals[valCnt++] = maxVal;
+        }
+        if (checkOperator(var, minVal)) {
+            if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << minVal << "   in inOpOnCons" << endl;
+            vals[valCnt++] = minVal;
         }
+        _operatorPool.push(var, vals, valCnt);
     }
 }
 
@@ -568,7 +888,7 @@ void LsSolver::insertOperatorOnCons(const Int consIndex) {
 bool LsSolver::doFeasibleSatOperator() {
     _operatorPool.clear();
 
-    Set<Int> visitedConsIndex;
+    _visitedCons.clear();
     for (const Variable& var : _objectiveVars) {
         // insertSatOperatorOnVar(var);
 
@@ -581,10 +901,11 @@ bool LsSolver::doFeasibleSatOperator() {
             _operatorPool.push(var, _assignment.getUB(var));
         }
 
-        for (const Int& consIndex : _var2ConsIndex[var]) {
-            if (visitedConsIndex.count(consIndex) > 0) continue;
-            if (_consValue[consIndex] == _formula->getConsVec()[consIndex].getLimit()) continue;
-            visitedConsIndex.insert(consIndex);
+        for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+            Int consIndex = _slotCons[_varSlot[i]];
+            if (_visitedCons.contains(consIndex)) continue;
+            if (!isSlackConstraint(consIndex)) continue;
+            _visitedCons.insert(consIndex);
             insertOperatorOnCons(consIndex);
         }
     }
@@ -597,31 +918,33 @@ bool LsSolver::doFeasibleSatOperator() {
 void LsSolver::insertSatOperatorOnVar(const Variable& var) {
     // const vector<Constraint>& consVec = _formula->getConsVec();
 
-    for (Int consIndex : _var2ConsIndex[var]) {
-        Int maxVal = findFeasibleVarValueOnCons(var, consIndex, true);
-        Int minVal = findFeasibleVarValueOnCons(var, consIndex, false);
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+        Int slot      = _varSlot[i];
+        Int consIndex = _slotCons[slot];
+        Int maxVal = findFeasibleVarValueOnSlot(slot, true);
+        Int minVal = findFeasibleVarValueOnSlot(slot, false);
 
         if (JUDGE) {
-            Float coefTerm = _consCoefOnVar[consIndex][var];
-            Float freeTerm = _consValue[consIndex] - coefTerm * getVarAssign(var);
-            Float maxValue = coefTerm * maxVal + freeTerm;
-            Float minValue = coefTerm * minVal + freeTerm;
-
-            Int limit = _formula->getConsVec()[consIndex].getLimit();
-            Op op     = _formula->getConsVec()[consIndex].getOp();
+            Num     coefTerm = getSlotCoef(slot);
+            WideNum freeTerm = _consValue[consIndex] - (WideNum) coefTerm * getVarAssign(var);
+            Num     maxValue = util::saturateNum((WideNum) coefTerm * maxVal + freeTerm);
+            Num     minValue = util::saturateNum((WideNum) coefTerm * minVal + freeTerm);
 
-            if (maxVal != DUMMY_MIN_INT) assert(judgeLimitOpVal(limit, op, maxValue));
-            if (minVal != DUMMY_MAX_INT) assert(judgeLimitOpVal(limit, op, minValue));
+            if (maxVal != DUMMY_MIN_INT) assert(isSatValue(consIndex, maxValue));
+            if (minVal != DUMMY_MAX_INT) assert(isSatValue(consIndex, minValue));
         }
 
+        Int vals[2];
+        Int valCnt = 0;
         if (checkOperator(var, maxVal)) {
-            _operatorPool.push(var, maxVal);
+            vals[valCnt++] = maxVal;
             if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << maxVal <<  "  in insertSatOpOnVar" << endl;
         }
         if (checkOperator(var, minVal)) {
-            _operatorPool.push(var, minVal);
+            vals[valCnt++] = minVal;
             if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << minVal <<  "  in insertSatOpOnVar" << endl;
         }
+        _operatorPool.push(var, vals, valCnt);
     }
 }
 
@@ -639,24 +962,22 @@ void LsSolver::insertSatOperatorOnVarUnBoundCons(const Variable& var, bool findM
     Int oldVarVal = getVarAssign(var);
     if (JUDGE) findMax ? assert(oldVarVal != _assignment.getUB(var)) : assert(oldVarVal != _assignment.getLB(var));
 
-    if (_options._tabuFlag && _curStep < _tabuStepOnVar[var]) return;
+    if (isTabu(var)) return;
 
-    for (Int consIndex : _var2ConsIndex[var]) {
-        const Constraint& cons = _formula->getConsVec()[consIndex];
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+        Int slot      = _varSlot[i];
+        Int consIndex = _slotCons[slot];
 
-        if (_consValue[consIndex] == cons.getLimit()) continue; // bounded
+        if (!isSlackConstraint(consIndex)) continue; // bounded
 
-        Int updVal = findFeasibleVarValueOnCons(var, consIndex, findMax);
+        Int updVal = findFeasibleVarValueOnSlot(slot, findMax);
 
         if (JUDGE) {
-            Float coefTerm = _consCoefOnVar[consIndex][var];
-            Float freeTerm = _consValue[consIndex] - coefTerm * getVarAssign(var);
-            Float updValue = coefTerm * updVal + freeTerm;
-
-            Int limit = cons.getLimit();
-            Op op     = cons.getOp();
+            Num     coefTerm = getSlotCoef(slot);
+            WideNum freeTerm = _consValue[consIndex] - (WideNum) coefTerm * getVarAssign(var);
+            Num     updValue = util::saturateNum((WideNum) coefTerm * updVal + freeTerm);
 
-            if (updVal != DUMMY_MIN_INT && updVal != DUMMY_MAX_INT) assert(judgeLimitOpVal(limit, op, updValue));
+            if (updVal != DUMMY_MIN_INT && updVal != DUMMY_MAX_INT) assert(isSatValue(consIndex, updValue));
         }
 
         if (findMax && updVal <= oldVarVal) continue;
@@ -676,7 +997,7 @@ bool LsSolver::doFeasibleUnSatOperator() {
     for (Int consIndex : _unSatConstraint) {
         if (DEBUG && _options._printStep) {
             cout << "UnSat Cons: [" << consIndex << "]:  " << _formula->getConsVec()[consIndex] << endl;
-            cout << "Value: " << _consValue[consIndex] << "  limit: " << _formula->getConsVec()[consIndex].getLimit() << endl;
+            cout << "Value: " << _consValue[consIndex] << "  limit: " << _consLimit[consIndex] << endl;
         }
         insertOperatorOnCons(consIndex);   
     }
@@ -690,10 +1011,9 @@ bool LsSolver::doObjectiveBoundMove() {
     if (JUDGE) assert(_unSatConstraint.size() == 0);
     _operatorPool.clear();
 
-    for (const Variable& var : _objectiveVars) {
-        Int varAssign = getVarAssign(var);
+    for (Int var : _unBoundedObjVars) {
         // assert coefTerm < 0
-        if (varAssign != _assignment.getUB(var)) insertSatBoundOperatorOnVar(var, true);
+        if (!isTabu(Variable(var))) insertSatBoundOperatorOnVar(Variable(var), true);
     }
 
     if (DEBUG && _options._printStep && !_operatorPool.empty()) cout << "In doObjectiveBoundMove: "; 
@@ -703,12 +1023,10 @@ bool LsSolver::doObjectiveBoundMove() {
 
 bool LsSolver::doObjectiveTwoLevelMove() {
     if (JUDGE) assert(_unSatConstraint.size() == 0);
-    const Polynomial& objectiveFunction = _formula->getObjectiveFunction();
     _operatorPool.clear();
 
-    for (const Variable& var : _objectiveVars) {
-        Int varAssign = getVarAssign(var);
-        if (varAssign != _assignment.getUB(var)) insertSatOperatorOnVarUnBoundCons(var, true);
+    for (Int var : _unBoundedObjVars) {
+        if (!isTabu(Variable(var))) insertSatOperatorOnVarUnBoundCons(Variable(var), true);
     }
 
     if (DEBUG && _options._printStep && !_operatorPool.empty()) cout << "In doObjectiveTwoLevelMove: ";
@@ -723,28 +1041,26 @@ bool LsSolver::doSampleSatMove() {
 
     _operatorPool.clear();
 
-    Set<unsigned> objVars;
-    vector<Pair<unsigned, Int> >  sampledVar2ConsIndex;
+    vector<Int>                   sampledVarSlot;             // <objVar, consIndex> as slot
     vector<Pair<unsigned, bool> > sampledVar2UpperFlag;        // <non-objVar, upper Flag>
 
     const Int sampleConsBMS  = 50;
     Int sampleConsCnt;
     /* randomly sample 50 constraint for vars in objective funtion */
-    for (const Variable& var : _objectiveVars) {
+    for (Int unBoundedVar : _unBoundedObjVars) {
         // assert coef < 0
-        objVars.insert(var);
-        if (getVarAssign(var) == _assignment.getUB(var)) continue;  // bounded var
+        Variable var(unBoundedVar);
 
-        Int consSize = _var2ConsIndex[var].size();
+        Int consSize = getVarConsCnt(var);
         sampleConsCnt = std::min(sampleConsBMS, consSize);
 
         for (Int randTimes = 0; randTimes < sampleConsCnt; randTimes++) {
-            Int consID = (sampleConsCnt == sampleConsBMS ? genRandom() % consSize : randTimes);
-            Int consIndex = _var2ConsIndex[var][consID];
+            Int consID = (sampleConsCnt == sampleConsBMS ? _random.bounded(consSize) : randTimes);
+            Int slot   = _varSlot[_varSlotBegin[var] + consID];
             // can not set back here
 
-            if (_consCoefOnVar[consIndex][var] == 0) continue;
-            sampledVar2ConsIndex.push_back(std::make_pair(var, consIndex));
+            if (getSlotCoef(slot) == 0) continue;
+            sampledVarSlot.push_back(slot);
         } 
     }
 
@@ -753,33 +1069,30 @@ bool LsSolver::doSampleSatMove() {
     Int sampleLinearCnt;
     Int sampleNonLinearCnt;
     /* sample 1000 constraint */
-    for (Pair<unsigned, Int>& var2Cons : sampledVar2ConsIndex) {
-        unsigned var  =  var2Cons.first;
-        Int consIndex = var2Cons.second;
-        Int setSize = _consVarSet[consIndex].size();
+    for (Int varSlot : sampledVarSlot) {
+        Int consIndex = _slotCons[varSlot];
+        Int setSize   = getConsSlotCnt(consIndex);
 
         const Constraint& cons = consVec[consIndex];
 
         if (!cons.isLinear()) {     // nonlinear
-            if (_consCoefOnVar[consIndex][var] >= 0) continue;  // only consider coefTerm < 0
+            if (getSlotFormulaCoef(varSlot) >= 0) continue;  // only consider coefTerm < 0
 
             assert(cons.getOp() == Op::GEQUAL);
             sampleNonLinearCnt = std::min(setSize, sampleNonLinearBMS); 
 
             for (Int randTimes = 0; randTimes < sampleNonLinearCnt; randTimes++) {
-                Int offset = (sampleNonLinearCnt == sampleNonLinearBMS ? genRandom() % setSize : randTimes);
-                
-                Set<unsigned>::iterator it = _consVarSet[consIndex].begin();
-                std::advance(it, offset);
-                unsigned curVar = *it;
+                Int offset = (sampleNonLinearCnt == sampleNonLinearBMS ? _random.bounded(setSize) : randTimes);
+                Int curSlot     = _consSlotBegin[consIndex] + offset;
+                unsigned curVar = _slotVar[curSlot];
 
                 // coefTerm * var + freeTerm >= 0
-                if (!objVars.count(curVar)) {
-                    if (isFactor(cons.getPolynomial(), curVar, var)) {
+                if (!_objectiveVarSet.contains(curVar)) {
+                    if (isFactor(curSlot, varSlot)) {
                         sampledVar2UpperFlag.push_back(std::make_pair(curVar, false));
                     }
                     else {
-                        if (_consCoefOnVar[consIndex][curVar] > 0) sampledVar2UpperFlag.push_back(std::make_pair(curVar, true));
+                        if (getSlotFormulaCoef(curSlot) > 0) sampledVar2UpperFlag.push_back(std::make_pair(curVar, true));
                         else sampledVar2UpperFlag.push_back(std::make_pair(curVar, false));
                     }
                 }
@@ -790,14 +1103,12 @@ bool LsSolver::doSampleSatMove() {
             sampleLinearCnt = std::min(setSize, sampleLinearBMS);
 
             for (Int randTimes = 0; randTimes < sampleLinearCnt; randTimes++) {
-                Int offset = (sampleLinearCnt == sampleLinearBMS ? genRandom() % setSize : randTimes);
-                
-                Set<unsigned>::iterator it = _consVarSet[consIndex].begin();
-                std::advance(it, offset);
-                unsigned curVar = *it;
-
-                if (!objVars.count(curVar)) {      // curVar not in objective function
-                    if (JUDGE) assert(_consCoefOnVar[consIndex][curVar] > 0);
+                Int offset = (sampleLinearCnt == sampleLinearBMS ? _random.bounded(setSize) : randTimes);
+                Int curSlot     = _consSlotBegin[consIndex] + offset;
+                unsigned curVar = _slotVar[curSlot];
+
+                if (!_objectiveVarSet.contains(curVar)) {      // curVar not in objective function
+                    if (JUDGE) assert(getSlotFormulaCoef(curSlot) > 0);
                     sampledVar2UpperFlag.push_back(std::make_pair(curVar, false));  // do lower
                 }
             }
@@ -810,26 +1121,26 @@ bool LsSolver::doSampleSatMove() {
         Variable var(var2Flag.first);
         bool     upperFlag = var2Flag.second;
 
-        Int consSize = _var2ConsIndex[var].size();
+        Int consSize = getVarConsCnt(var);
         // sampleConsCnt = consSize > sampleConsBMS ? sampleConsBMS : consSize;
         sampleConsCnt = sampleConsBMS;
 
         for (Int randTimes = 0; randTimes < sampleConsCnt; randTimes++) {
-            Int consID = (sampleConsCnt == sampleConsBMS ? genRandom() % consSize : randTimes);
-            Int consIndex = _var2ConsIndex[var][consID];
+            Int consID = (sampleConsCnt == sampleConsBMS ? _random.bounded(consSize) : randTimes);
+            Int slot   = _varSlot[_varSlotBegin[var] + consID];
             // const Constraint& cons = consVec[consIndex];
 
-            if (_consCoefOnVar[consIndex][var] == 0) continue;      // coefTerm != 0
+            if (getSlotCoef(slot) == 0) continue;      // coefTerm != 0
             
             if (upperFlag) {
-                Int maxVal = findFeasibleVarValueOnCons(var, consIndex, true);
+                Int maxVal = findFeasibleVarValueOnSlot(slot, true);
                 if (checkOperator(var, maxVal)) {
                     _operatorPool.push(var, maxVal);
                     if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << maxVal <<  "  in sampleSatOp" << endl;
                 }
             }
             else {
-                Int minVal = findFeasibleVarValueOnCons(var, consIndex, false);
+                Int minVal = findFeasibleVarValueOnSlot(slot, false);
                 if (checkOperator(var, minVal)) {
                     _operatorPool.push(var, minVal);
                     if (DEBUG && var == _debugVar) cout << "Operator Pool add: " << var << " -> " << minVal <<  "  in sampleSatOp" << endl;
@@ -844,20 +1155,33 @@ bool LsSolver::doSampleSatMove() {
     return false;
 }
 
-// ??? update, now is O(n)  maybe n^2
-bool LsSolver::isFactor(const Polynomial& poly, unsigned var1, unsigned var2) const {
-    Variable minVar(std::min(var1, var2));
-    Variable maxVar(std::max(var1, var2));
-
-    Monomial judgeMono = Monomial(minVar, 1) * Monomial(maxVar, 1);
+/**
+ * @brief var1 * var2 is a term of the constraint, both slots in the same constraint
+ *        factored: var1 and var2 in the two factors of one product
+ */
+bool LsSolver::isFactor(Int slot1, Int slot2) const {
+    if (JUDGE) assert(_slotCons[slot1] == _slotCons[slot2]);
+    if (_slotFactorBase[slot1] >= 0) {
+        const Num* coef1 = &_slotFactorCoef[_slotFactorBase[slot1]];
+        const Num* coef2 = &_slotFactorCoef[_slotFactorBase[slot2]];
+        for (Int k = 0; k < Constraint::factorCnt; k++) {
+            if (coef1[k] != 0 && coef2[k ^ 1] != 0) return true;
+        }
+        return false;
+    }
 
-    for (const Monomial& mono : poly.getMonoVec()) {
-        if (judgeMono == mono) return true;
+    // a term of exactly the two vars, slots of a constraint are sorted by var as the vars of a term
+    Int minSlot = std::min(slot1, slot2);
+    Int maxSlot = std::max(slot1, slot2);
+    for (Int i = _slotTermBegin[slot1]; i < _slotTermBegin[slot1 + 1]; i++) {
+        Int begin = _termSlotBegin[_slotTerm[i]];
+        if (_termSlotBegin[_slotTerm[i] + 1] - begin == 2 && _termSlot[begin] == minSlot && _termSlot[begin + 1] == maxSlot) return true;
     }
     return false;
 }
 
 bool LsSolver::selectOperatorAndMove(Float minScore) {
+    STATS(_stats.countPoolSize(_operatorPool.size()));      // empty pools too, bucket 0
     if (_operatorPool.empty()) return false;
 
     Int  poolSize = _operatorPool.size();
@@ -870,61 +1194,62 @@ bool LsSolver::selectOperatorAndMove(Float minScore) {
     Int      bestValue;
     Float    bestScore = NEGATIVE_INFINITY;
 
+    STATS(uint64_t scoreStart = SearchStats::cycles());
+    if ((Int) _smpVar.size() < smpCnt) {
+        _smpVar.resize(smpCnt);
+        _smpVal.resize(smpCnt);
+        _smpScore.resize(smpCnt);
+    }
     for (Int i = 0; i < smpCnt; i++) {
-        Variable curVar;
-        Int      curValue;
-        Float    curScore = NEGATIVE_INFINITY;
-
         assert(poolSize > 0);
 
-        Int randIndex = genRandom() % poolSize;
-        curVar   = _operatorPool.varAt(randIndex);
-        curValue = _operatorPool.valAt(randIndex);
+        Int randIndex = _random.bounded(poolSize);
+        _smpVar[i] = _operatorPool.varAt(randIndex);
+        _smpVal[i] = _operatorPool.valAt(randIndex);
         _operatorPool.removeOpAt(randIndex); 
         poolSize--;
+    }
+
+    clacScoreBatch(smpCnt);
 
-        curScore = clacScore(curVar, curValue);
-        if (DEBUG && curVar == _debugVar) cout << curVar << " " << getVarAssign(curVar) << " -> " << curValue << "  score: " << curScore << endl;
-        if (curScore > bestScore) {
-            bestScore = curScore;
-            bestVar   = curVar;
-            bestValue = curValue;
+    for (Int i = 0; i < smpCnt; i++) {
+        if (DEBUG && _smpVar[i] == _debugVar) cout << _smpVar[i] << " " << getVarAssign(_smpVar[i]) << " -> " << _smpVal[i] << "  score: " << _smpScore[i] << endl;
+        if (_smpScore[i] > bestScore) {
+            bestScore = _smpScore[i];
+            bestVar   = _smpVar[i];
+            bestValue = _smpVal[i];
         }
     }
+    STATS(_stats.addCycles(SearchStats::SCORE, SearchStats::cycles() - scoreStart));
 
     if (DEBUG && _options._printStep) cout << "After select best score: " << bestScore 
         << " (" << clacHardScore(bestVar, bestValue) << ", " << clacSoftScore(bestVar, bestValue) 
         << ")  " << bestVar << " -> " << bestValue << endl;
-    if (bestScore > minScore) {
-        setVarWithNewVal(bestVar, bestValue);
-        return true;
-    } 
+    if (bestScore > minScore) return setVarWithNewVal(bestVar, bestValue);
     return false;
 }
 
 /**
- * @brief coef * var + free [op] limit
- * 
+ * @brief coef * var + free <= limit
+ *        reference of clacScoreBatch, one slot at a time
  */
 Float LsSolver::clacHardScore(Variable var, Int val) const {
     Float    score = 0;
 
-    for (Int consIndex : _var2ConsIndex[var]) {
-        const Constraint& cons = _formula->getConsVec()[consIndex];
-
-        Int limit  = cons.getLimit();
-        Op  op     = cons.getOp();
-        if (JUDGE) assert(_consVarSet[consIndex].count(var) > 0);
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+        Int slot      = _varSlot[i];
+        Int consIndex = _slotCons[slot];
+        if (JUDGE) assert(_slotVar[slot] == var);
 
-        Float coefTerm   = _consCoefOnVar[consIndex].at(var);
-        Float freeTerm   = _consValue[consIndex] - coefTerm * getVarAssign(var);
+        Num     coefTerm   = getSlotCoef(slot);
+        WideNum freeTerm   = _consValue[consIndex] - (WideNum) coefTerm * getVarAssign(var);
 
-        Float preValue   = _consValue[consIndex];
-        Float postValue  = freeTerm + coefTerm * val;
+        Num     preValue   = _consValue[consIndex];
+        Num     postValue  = util::saturateNum(freeTerm + (WideNum) coefTerm * val);
         if (JUDGE) assert(preValue == _consValue[consIndex]);
 
-        bool preSat  = judgeLimitOpVal(limit, op, preValue);
-        bool postSat = judgeLimitOpVal(limit, op, postValue);
+        bool preSat  = isSatValue(consIndex, preValue);
+        bool postSat = isSatValue(consIndex, postValue);
 
         if (preSat && !postSat) {       // sat -> unsat 
             score -= _consWeight[consIndex];
@@ -936,9 +1261,75 @@ Float LsSolver::clacHardScore(Variable var, Int val) const {
     return score;
 }
 
+/**
+ * @brief rows of the kind slots of the sampled operator, only a factored slot derives its coefficient
+ * 
+ */
+template <LsSolver::SlotKind kind>
+Int LsSolver::gatherKindRows(Int smpIndex, Int row) {
+    Variable var    = _smpVar[smpIndex];
+    Int      val    = _smpVal[smpIndex];
+    Int      assign = getVarAssign(var);
+    Int      begin  = _varKindSlotBegin[var * SLOT_KIND_CNT + kind];
+    Int      end    = _varKindSlotBegin[var * SLOT_KIND_CNT + kind + 1];
+    for (Int j = begin; j < end; j++, row++) {
+        Int     slot      = _varKindSlot[j];
+        Int     consIndex = _slotCons[slot];
+        Num     coefTerm  = getKindSlotCoef<kind>(slot);
+        WideNum freeTerm  = _consValue[consIndex] - (WideNum) coefTerm * assign;
+
+        _rowSmp[row]  = smpIndex;
+        _rowCons[row] = consIndex;
+        _rowPre[row]  = _consValue[consIndex];
+        _rowPost[row] = util::saturateNum(freeTerm + (WideNum) coefTerm * val);
+    }
+    return row;
+}
+
+/**
+ * @brief clacScore of all sampled operators at once
+ *        gather: every (operator, slot) pair becomes a row of flat arrays, no Constraint is touched
+ *                slots are gathered per SlotKind, only factored slots derive their coefficient
+ *        transition: branch free compare on the rows, one pass, every row is value <= limit
+ *        reduce: weighted transitions summed per operator, weights are integers so the sum does not depend on the row order
+ */
+void LsSolver::clacScoreBatch(Int smpCnt) {
+    Int rowCnt = 0;
+    for (Int i = 0; i < smpCnt; i++) rowCnt += _varSlotBegin[_smpVar[i] + 1] - _varSlotBegin[_smpVar[i]];
+    if ((Int) _rowSmp.size() < rowCnt) {
+        _rowSmp.resize(rowCnt);
+        _rowCons.resize(rowCnt);
+        _rowPre.resize(rowCnt);
+        _rowPost.resize(rowCnt);
+        _rowTrans.resize(rowCnt);
+    }
+
+    Int row = 0;
+    for (Int i = 0; i < smpCnt; i++) {
+        row = gatherKindRows<LINEAR_SLOT>(i, row);
+        row = gatherKindRows<NONLINEAR_SLOT>(i, row);
+        row = gatherKindRows<FACTORED_SLOT>(i, row);
+    }
+    if (JUDGE) assert(row == rowCnt);
+
+    for (Int r = 0; r < rowCnt; r++) {
+        Int limit = _consLimit[_rowCons[r]];
+        _rowTrans[r] = (Int) (_rowPost[r] <= limit) - (Int) (_rowPre[r] <= limit);
+    }
+
+    for (Int i = 0; i < smpCnt; i++) _smpScore[i] = 0;
+    for (Int r = 0; r < rowCnt; r++) {
+        if (_rowTrans[r] != 0) _smpScore[_rowSmp[r]] += _rowTrans[r] * _consWeight[_rowCons[r]];
+    }
+    for (Int i = 0; i < smpCnt; i++) _smpScore[i] += clacSoftScore(_smpVar[i], _smpVal[i]);
+
+    if (JUDGE) {
+        for (Int i = 0; i < smpCnt; i++) assert(_smpScore[i] == clacScore(_smpVar[i], _smpVal[i]));
+    }
+}
+
 Float LsSolver::clacSoftScore(Variable var, Int val) const {
-    Float coef  = calcVarCoefOnPoly(_formula->getObjectiveFunction(), var);
-    Float score = coef * (val - getVarAssign(var));       // minimize objective function
+    Float score = _objCoefOnVar[var] * (val - getVarAssign(var));       // minimize objective function
 
     if (score < 0) return 1.0 * _objectWeight;
     else if (score > 0) return -1.0 * _objectWeight;
@@ -951,98 +1342,71 @@ Float LsSolver::clacSoftScore(Variable var, Int val) const {
  */
 void LsSolver::randomWalkSat() {
     _operatorPool.clear();
-    vector<Int> consPool;
-    const vector<Constraint>& consVec = _formula->getConsVec();
-    for (Int consIndex = 0; consIndex < _consCnt; consIndex++) {
-        if (JUDGE) assert(!isUnSatConstraint(consIndex));
-        if (_consValue[consIndex] != consVec[consIndex].getLimit()) consPool.push_back(consIndex);
-    }
 
-    Int consPoolSize = consPool.size();
+    Int consPoolSize = _slackConstraint.size();
     for (Int i = 0 ; i < _options._randomStep; i++) {
         Int index;
-        if (consPool.size() <= _options._randomStep) {
-            if (i >= consPool.size()) break;
+        if (consPoolSize <= _options._randomStep) {
+            if (i >= consPoolSize) break;
             index = i;
         }
-        else index = genRandom() % (consPoolSize - 1);
+        else index = _random.bounded(consPoolSize);
 
-        insertOperatorOnCons(consPool[index]);
+        insertOperatorOnCons(_slackConstraint[index]);
     }
 
-    Int randomSelectConsIndex = consPool.size() == 1 ? 0 : consPool[genRandom() % (consPoolSize - 1)];
+    // every constraint tight: walk on any of them
+    Int randomSelectConsIndex = consPoolSize > 0 ? _slackConstraint[_random.bounded(consPoolSize)] : _random.bounded(_consCnt);
 
     if (DEBUG && _options._printStep && !_operatorPool.empty()) cout << "In randomWalkSat: ";
     if (!_operatorPool.empty() && selectOperatorAndMove(NEGATIVE_INFINITY)) return;     // 有操作就执行
-    else randomWalkOnCons(consVec[randomSelectConsIndex]);
+    else randomWalkOnCons(randomSelectConsIndex);
 }
 
 bool LsSolver::randomWalkSatOnObjVar() {
-    vector<Variable> unBoundedObjVars;
-    for (const Variable& var : _objectiveVars) {
-        if (getVarAssign(var) != _assignment.getUB(var)) unBoundedObjVars.push_back(var);
-    }
+    if (_unBoundedObjVars.empty()) return false;
 
-    if (unBoundedObjVars.size() == 0) return false;
-
-    Int randInex = genRandom() % unBoundedObjVars.size();
-
-    Variable var = unBoundedObjVars[randInex];
+    Variable var(_unBoundedObjVars[_random.bounded(_unBoundedObjVars.size())]);
     Int newVal = getVarAssign(var) + 1;
+    if (!_assignment.isValid(var, newVal)) return false;
 
-    if (JUDGE) assert(newVal <= _assignment.getUB(var));
-
-    setVarWithNewVal(var, newVal);
-    return true;
+    return setVarWithNewVal(var, newVal);
 }
 
 void LsSolver::randomWalkUnSat() {
     _operatorPool.clear();
 
-    vector<Int> consPool;
-    const vector<Constraint>& consVec = _formula->getConsVec();
-    for (Int consIndex : _unSatConstraint) {
-        if (JUDGE) assert(isUnSatConstraint(consIndex));
-        consPool.push_back(consIndex);
-    }
-
-    Int consPoolSize = consPool.size();
+    Int consPoolSize = _unSatConstraint.size();
+    assert(consPoolSize > 0);
     for (Int i = 0 ; i < _options._randomStep; i++) {
         Int index;
-        if (consPool.size() <= _options._randomStep) {
-            if (i >= consPool.size()) break;
+        if (consPoolSize <= _options._randomStep) {
+            if (i >= consPoolSize) break;
             index = i;
         }
-        else index = genRandom() % (consPoolSize - 1);
+        else index = _random.bounded(consPoolSize);
 
-        // insertOperatorOnCons(consVec.at(consPool.at(index)));
-        insertOperatorOnCons(consPool[index]);
+        insertOperatorOnCons(_unSatConstraint[index]);
     }
 
-    // Int randomSelectConsIndex = consPool.size() == 1 ? 0 : consPool.at(genRandom() % (consPoolSize - 1));
-    Int randomSelectConsIndex = consPool.size() == 1 ? 0 : consPool[genRandom() % (consPoolSize - 1)];
+    Int randomSelectConsIndex = _unSatConstraint[_random.bounded(consPoolSize)];
 
     if (DEBUG && _options._printStep && !_operatorPool.empty()) cout << "In randomWalkUnSat: ";
     if (!_operatorPool.empty() && selectOperatorAndMove(NEGATIVE_INFINITY)) return;
-    else randomWalkOnCons(consVec[randomSelectConsIndex]);
+    else randomWalkOnCons(randomSelectConsIndex);
 }
 
-void LsSolver::randomWalkOnCons(const Constraint& cons) {
+void LsSolver::randomWalkOnCons(Int consIndex) {
     /* random select cons and var */
     if (DEBUG && _options._printStep) {
         cout << "Completely random walk" << std::endl;
-        cout << cons.getPolynomial() << " " << cons.getOp() << " " << cons.getLimit() << endl;
+        cout << _formula->getConsVec()[consIndex] << endl;
     }
     if (JUDGE) assert(_operatorPool.empty());
-    vector<Variable> varPool;
-    for (const Monomial& mono : cons.getMonoVec()) {
-        for (const Variable& var : mono.getVars()) {
-            varPool.push_back(var);
-        }
-    }
-    assert(varPool.size() >= 1);
-    Variable selectVar = varPool[varPool.size() == 1 ? 0 : genRandom() % (varPool.size() - 1)];
-    Int val = genRandom() % 2 ? _assignment.getLB(selectVar) : _assignment.getUB(selectVar);
+    Int varPoolSize = getConsSlotCnt(consIndex);
+    assert(varPoolSize >= 1);
+    Variable selectVar = _slotVar[_consSlotBegin[consIndex] + (varPoolSize == 1 ? 0 : _random.bounded(varPoolSize - 1))];
+    Int val = _random.bounded(2) ? _assignment.getLB(selectVar) : _assignment.getUB(selectVar);
 
     if (val == _assignment.getUB(selectVar)) val = _assignment.getLB(selectVar);
     else if (val == _assignment.getLB(selectVar)) val = _assignment.getUB(selectVar);
@@ -1050,79 +1414,161 @@ void LsSolver::randomWalkOnCons(const Constraint& cons) {
     setVarWithNewVal(selectVar, val);
 }
 
+/**
+ * @brief update _consValue
+ *               _slotCoef
+ *        with delta only, var appears at most once in every monomial (multilinear)
+ *        mono = c * var * rest:  d(mono) = c * delta * rest
+ *                                d(coef of other) = c * delta * rest / other
+ *        LINEAR_SLOT has no term of var, FACTORED_SLOT updates the factor values
+ */
+template <LsSolver::SlotKind kind>
+void LsSolver::updateConsInfo(const Int& slot, const Int& delta) {
+    Int      consIndex = _slotCons[slot];
+    Variable var       = _slotVar[slot];
+    const Constraint& cons = _formula->getConsVec()[consIndex];
+    if (JUDGE) assert(cons.isFactored() == (kind == FACTORED_SLOT));
+    if (JUDGE) assert((_slotTermBegin[slot] != _slotTermBegin[slot + 1]) == (kind == NONLINEAR_SLOT));
+
+    // now assign of var is new var
+    if (kind == FACTORED_SLOT) {    // factor values by delta, cons value from the two products
+        const Num* coef   = &_slotFactorCoef[_slotFactorBase[slot]];
+        Num*       factor = &_factorValue[_consFactorBase[consIndex]];
+        for (Int k = 0; k < Constraint::factorCnt; k++) factor[k] = util::narrowNum(factor[k] + (WideNum) coef[k] * delta);
+        _consValue[consIndex] = util::narrowNum((WideNum) factor[0] * factor[1] - (WideNum) factor[2] * factor[3]);
+
+        if (JUDGE) assert(_consValue[consIndex] == _consDir[consIndex] * calcConsValue(cons));
+        return;
+    }
+
+    Num coefTerm = _slotCoef[slot];
+    _consValue[consIndex] = util::narrowNum(_consValue[consIndex] + (WideNum) coefTerm * delta);
+
+    if (JUDGE) assert(coefTerm == _consDir[consIndex] * calcVarCoefOnCons(cons, var));
+    if (JUDGE) assert(_consValue[consIndex] - (WideNum) coefTerm * getVarAssign(var) == _consDir[consIndex] * calcConsValueExVar(cons, var));
+
+    if (kind == LINEAR_SLOT) return;    // linear do not need update coef term
+    for (Int i = _slotTermBegin[slot]; i < _slotTermBegin[slot + 1]; i++) {
+        // var \in term, adjust otherVar's coef
+        Int   term  = _slotTerm[i];
+        Int   begin = _termSlotBegin[term], end = _termSlotBegin[term + 1];
+        WideNum scale = (WideNum) _termCoef[term] * delta;
+        for (Int j = begin; j < end; j++) {
+            Int otherSlot = _termSlot[j];
+            if (otherSlot == slot) continue;
+            WideNum coefDelta = scale;
+            for (Int k = begin; k < end; k++) {
+                if (_termSlot[k] != slot && _termSlot[k] != otherSlot) coefDelta *= getVarAssign(_slotVar[_termSlot[k]]);
+            }
+            Num& otherCoef = _slotCoef[otherSlot];
+            if (DEBUG && _slotVar[otherSlot] == _debugVar && false) cout << "DEBUG Var: " << _slotVar[otherSlot] << " preCoef: " << otherCoef;
+            otherCoef = util::narrowNum(otherCoef + coefDelta);
+            if (DEBUG && _slotVar[otherSlot] == _debugVar && false) cout << " postCoef: " << otherCoef << " calcCoef: " << (Float) calcVarCoefOnPoly(cons.getPolynomial(), _slotVar[otherSlot]) << endl;
+        }
+    }
+}
+
 /**
  * @brief update _assignment
  *               _consValue
  *               _unSatConstraint
  *               _tabuStepOnVar
- *               _consCoefOnVar
- *               _consFreeOnVar
+ *               _slotCoef
  */
-void LsSolver::setVarWithNewVal(const Variable& var, Int val) {
+bool LsSolver::setVarWithNewVal(const Variable& var, Int val) {
     if (JUDGE) assert(_assignment.isValid(var, val));
     if (DEBUG && _options._printStep) cout << "Set: " << var << " " << val << endl;
     
     Int oldVal = getVarAssign(var);
-    if (oldVal == val) return ;
+    if (oldVal == val) return true;
+    if (!isMoveInRange(var, val)) {     // keep the state exact, var sits out the tabu tenure instead of moving
+        if (DEBUG && _options._printStep) cout << "Reject: " << var << " " << val << " overflows 64 bits" << endl;
+        if (_options._tabuFlag) _tabuStepOnVar[var] = _curStep + _options._tabuConst + _random.bounded(_options._tabuRand);
+        return false;
+    }
 
+    STATS(uint64_t updateStart = SearchStats::cycles());
     setVarAssign(var, val);     // now assign of var is newVal
-
-    const vector<Constraint>& conVec = _formula->getConsVec();
-    for (Int consIndex : _var2ConsIndex[var]) {
-        updateConsInfo(consIndex, var, val - oldVal);
-
-        const Constraint& cons = conVec[consIndex];
-        _consValue[consIndex] = calcConsValue(cons);
-
-        Op  op    = cons.getOp();
-        Int limit = cons.getLimit();
-        Int val   = _consValue[consIndex];
-
-        if (judgeLimitOpVal(limit, op, val)) {
+    _curObjectiveValue += _objCoefOnVar[var] * (val - oldVal);
+    if (_objectiveVarSet.contains(var)) updateUnBoundedObjVar(var);
+
+    // _consValue is kept by delta only, one kernel per kind, every slot of var is in another constraint
+    Int delta = val - oldVal;
+    Int kindBegin = var * SLOT_KIND_CNT;
+    for (Int i = _varKindSlotBegin[kindBegin + LINEAR_SLOT]; i < _varKindSlotBegin[kindBegin + LINEAR_SLOT + 1]; i++)
+        updateConsInfo<LINEAR_SLOT>(_varKindSlot[i], delta);
+    for (Int i = _varKindSlotBegin[kindBegin + NONLINEAR_SLOT]; i < _varKindSlotBegin[kindBegin + NONLINEAR_SLOT + 1]; i++)
+        updateConsInfo<NONLINEAR_SLOT>(_varKindSlot[i], delta);
+    for (Int i = _varKindSlotBegin[kindBegin + FACTORED_SLOT]; i < _varKindSlotBegin[kindBegin + FACTORED_SLOT + 1]; i++)
+        updateConsInfo<FACTORED_SLOT>(_varKindSlot[i], delta);
+
+    // unsat and slack sets in consIndex order, their order drives the sampling
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1]; i++) {
+        Int consIndex = _slotCons[_varSlot[i]];
+
+        if (isSatValue(consIndex, _consValue[consIndex])) {
             if (isUnSatConstraint(consIndex)) delUnSatConstraint(consIndex);
         }
         else {
             if (!isUnSatConstraint(consIndex)) addUnSatConstraint(consIndex);
         }
+        updateSlackConstraint(consIndex);
     }
 
     if (_options._tabuFlag) {       // update tabuStepOnVar
         if (DEBUG && var == _debugVar) cout << var << ": " << _tabuStepOnVar.at(var) << "  curStep: " << _curStep << endl;
-        _tabuStepOnVar[var] = _curStep + _options._tabuConst + genRandom() % _options._tabuRand;
+        _tabuStepOnVar[var] = _curStep + _options._tabuConst + _random.bounded(_options._tabuRand);
     }
+    STATS(_stats.addCycles(SearchStats::UPDATE, SearchStats::cycles() - updateStart));
+    return true;
 }
 
 /**
- * @brief update _consValue
- *               _consCoefOnVar
- *               _consFreeOnVar
- *               _unSatConstraint
+ * @brief dry run of the update kernels of setVarWithNewVal, nothing is changed
+ *        cons values, factor values and coefficients of the other slots of a term are checked as they are written,
+ *        products of a coefficient delta with checked WideNum multiplication
  */
-void LsSolver::updateConsInfo(const Int& consIndex, const Variable& var, const Int& delta) {
-    const Constraint& cons = _formula->getConsVec()[consIndex];
+bool LsSolver::isMoveInRange(const Variable& var, Int val) {
+#ifdef LS_FLOAT_VALUE
+    return true;
+#else
+    WideNum delta = (WideNum) val - getVarAssign(var);
+    bool    fits  = true;
+    for (Int i = _varSlotBegin[var]; i < _varSlotBegin[var + 1] && fits; i++) {
+        Int slot      = _varSlot[i];
+        Int consIndex = _slotCons[slot];
+
+        if (_slotFactorBase[slot] >= 0) {
+            const Num* coef   = &_slotFactorCoef[_slotFactorBase[slot]];
+            const Num* factor = &_factorValue[_consFactorBase[consIndex]];
+            WideNum    post[Constraint::factorCnt];
+            for (Int k = 0; k < Constraint::factorCnt; k++) {
+                post[k] = factor[k] + coef[k] * delta;
+                fits    = fits && util::fitsNum(post[k]);
+            }
+            fits = fits && util::fitsNum(post[0] * post[1] - post[2] * post[3]);   // factors fit a Num, so do the products
+            continue;
+        }
 
-    // now assign of var is new var
-    Float coefTerm = _consCoefOnVar[consIndex][var];
-    _consValue[consIndex] += coefTerm * delta;
-    Float freeTerm = _consValue[consIndex] - coefTerm * getVarAssign(var);
-
-    if (JUDGE) assert(coefTerm == calcVarCoefOnPoly(cons.getPolynomial(), var));
-    if (JUDGE) assert(freeTerm == calcConsValueExVar(cons, var));
-    if (JUDGE) assert(coefTerm * getVarAssign(var) + freeTerm == _consValue.at(consIndex));
-
-    if (!cons.isLinear()) {              // linear do not need update coef term
-        Map<unsigned, Float>& curCoefOnVar = _consCoefOnVar[consIndex];
-        for (const Monomial& mono : cons.getMonoVec()) {
-            if (mono.isContain(var)) {  // var \in mono, adjust otherVar's coef
-                for (const Variable& otherVar : mono.getVars()) {
-                    if (otherVar == var) continue;
-                    if (DEBUG && otherVar == _debugVar && false) cout << "DEBUG Var: " << otherVar << " preCoef: " << curCoefOnVar[otherVar];
-                    curCoefOnVar[otherVar] += mono.getCoef() * delta;
-                    if (DEBUG && otherVar == _debugVar && false) cout << " postCoef: " << curCoefOnVar[otherVar] << " calcCoef: " << calcVarCoefOnPoly(cons.getPolynomial(), otherVar) << endl;
+        fits = util::fitsNum(_consValue[consIndex] + _slotCoef[slot] * delta);
+        for (Int j = _slotTermBegin[slot]; j < _slotTermBegin[slot + 1] && fits; j++) {
+            Int term  = _slotTerm[j];
+            Int begin = _termSlotBegin[term], end = _termSlotBegin[term + 1];
+            for (Int k = begin; k < end && fits; k++) {
+                Int otherSlot = _termSlot[k];
+                if (otherSlot == slot) continue;
+                WideNum coefDelta = _termCoef[term] * delta;
+                for (Int l = begin; l < end && fits; l++) {
+                    if (_termSlot[l] != slot && _termSlot[l] != otherSlot) fits = util::mulWide(coefDelta, getVarAssign(_slotVar[_termSlot[l]]), coefDelta);
                 }
+                if (_pendingSlot.insert(otherSlot)) _pendingCoef[otherSlot] = _slotCoef[otherSlot];
+                fits = fits && util::addWide(_pendingCoef[otherSlot], coefDelta, _pendingCoef[otherSlot]) && util::fitsNum(_pendingCoef[otherSlot]);
             }
         }
+        _pendingSlot.clear();       // slots of one term are in one constraint, the next slot of var is in another
     }
+    return fits;
+#endif
 }
 
 void LsSolver::updateConstraintWeight() {
@@ -1130,8 +1576,8 @@ void LsSolver::updateConstraintWeight() {
     for (Int consIndex : _unSatConstraint) {
         const Constraint& cons = consVec[consIndex];
 
-        if (JUDGE) assert(_consValue.at(consIndex) == calcConsValue(cons));
-        if (JUDGE) assert(!judgeLimitOpVal(cons.getLimit(), cons.getOp(), _consValue.at(consIndex)));
+        if (JUDGE) assert(_consValue.at(consIndex) == _consDir.at(consIndex) * calcConsValue(cons));
+        if (JUDGE) assert(!isSatValue(consIndex, _consValue.at(consIndex)));
 
         _consWeight[consIndex]++;
     }
@@ -1158,7 +1604,7 @@ bool LsSolver::updateResultJudge() {
 }
 
 void LsSolver::updateResult() {
-    _curObjectiveValue = calcPolyValue(_formula->getObjectiveFunction());
+    if (JUDGE && _curStep % _options._judgeInterval == 0) assert(_curObjectiveValue == calcPolyValue(_formula->getObjectiveFunction()));
     if (updateResultJudge()) {
         if (JUDGE) assert (_unSatConstraint.size() <= _bestUnSatConsNum);
 
@@ -1167,11 +1613,54 @@ void LsSolver::updateResult() {
         _bestUnSatConsNum   = _unSatConstraint.size();
         _bestAssignment     = _assignment;
         _bestObjectiveValue = _curObjectiveValue;
+        _lastImproveStep    = _curStep;
+
+        if (_sharedIncumbent != nullptr) _sharedIncumbent->publish(_bestUnSatConsNum, _bestObjectiveValue, _assignment, _threadIndex);
+    }
+    else if (_sharedIncumbent != nullptr && _curStep - _lastImproveStep > _options._importStep) {
+        importSharedIncumbent();
     }
 }
 
+/**
+ * @brief restart search from values, clamped to bounds
+ *        _consValue _unSatConstraint and coefficients are rebuilt from scratch
+ */
+void LsSolver::resetAssignment(const vector<Int>& values) {
+    assert((Int) values.size() == _varCnt);
+    for (Variable var = Variable::start; var != _varCnt; var++) {
+        Int val = std::max(getVarLB(var), std::min(getVarUB(var), values[var]));
+        setVarAssign(var, val);
+    }
+
+    _unSatConstraint.clear();
+    initConsValue();
+    initConsCoef();
+    _curObjectiveValue = calcPolyValue(_formula->getObjectiveFunction());
+    initUnBoundedObjVars();
+}
+
+/**
+ * @brief stagnated, continue from the shared incumbent if another thread did better
+ * 
+ */
+bool LsSolver::importSharedIncumbent() {
+    _lastImproveStep = _curStep;        // wait another _importStep steps before next try
+    if (_sharedIncumbent->getVersion() == _importedVersion) return false;
+
+    vector<Int> values;
+    Int   unSatConsNum;
+    Float objectiveValue;
+    if (!_sharedIncumbent->fetch(values, unSatConsNum, objectiveValue, _importedVersion)) return false;
+    if (unSatConsNum > _bestUnSatConsNum || (unSatConsNum == _bestUnSatConsNum && objectiveValue >= _bestObjectiveValue)) return false;
+
+    if (DEBUG && _options._printStep) cout << "Import incumbent: " << unSatConsNum << " " << objectiveValue << endl;
+    resetAssignment(values);
+    return true;
+}
+
 void LsSolver::oldVersion() {
-    cout << "This is old Version" << endl;
+    if (_options._printResult) cout << "This is old Version" << endl;
     Int liftCnt = 0;
     Int feasibleSatCnt = 0, feasibleUnSatCnt = 0;
     Int randomSatCnt = 0, randomUnSatCnt = 0;
@@ -1180,12 +1669,11 @@ void LsSolver::oldVersion() {
         if (DEBUG && _options._printStep) {
             cout << endl << "step: " << _curStep << ", ";
             cout << "#unsat: " << getUnSatConsCnt() << ", ";
-            cout << "Time: " << util::getSeconds(startTime) << endl;
+            cout << "Time: " << util::getSeconds(_startTime) << endl;
             cout << "Best Value: " << _bestObjectiveValue << endl;
         }
         if (checkOffFlag()) {
-            displayOffInfo();
-            displayBestSolution();
+            displayResult();
             return ;
         }
 
@@ -1221,7 +1709,7 @@ void LsSolver::oldVersion() {
                 } else if (str == "print_UNSAT") {
                     for (Int consIndex : _unSatConstraint) {
                         cout << "UnSat Cons: [" << consIndex << "] (" << _consWeight[consIndex] << "):  " << _formula->getConsVec()[consIndex] << endl;
-                        cout << "Value: " << _consValue[consIndex] << "  limit: " << _formula->getConsVec()[consIndex].getLimit() << endl;
+                        cout << "Value: " << _consValue[consIndex] << "  limit: " << _consLimit[consIndex] << endl;
                     }
                 }
                 cout << endl << "wait input: ";
@@ -1230,121 +1718,140 @@ void LsSolver::oldVersion() {
 
         // Main Search
         if (getSatState()) {    // SAT
-            if (_options._liftFlag && liftObjectiveFunction()) {
+            if (_options._liftFlag && STATS_MOVE(LIFT, liftObjectiveFunction())) {
                 if (DEBUG && _options._printStep) cout << "Did Lift Op" << endl;
                 liftCnt++;
                 judgeRandomOp = true;
             }
-            else if (doFeasibleSatOperator()) {
+            else if (STATS_MOVE(FEASIBLE_SAT, doFeasibleSatOperator())) {
                 if (DEBUG && _options._printStep) cout << "Did feasible Sat Op" << endl;
                 feasibleSatCnt++;
             }
             else {
                 updateConstraintWeight();
-                randomWalkSat();
+                STATS_MOVE(RANDOM_WALK_SAT, (randomWalkSat(), true));
                 randomSatCnt++;
                 judgeRandomOp = true;
                 if (DEBUG && _options._printStep) cout << "Did Random Walk On Sat" << endl;
             }
         }
         else {                  // UNSAT
-            if (doFeasibleUnSatOperator()) {
+            if (STATS_MOVE(FEASIBLE_UNSAT, doFeasibleUnSatOperator())) {
                 if (DEBUG && _options._printStep) cout << "Did feasible UnSat Op" << endl;
                 feasibleUnSatCnt++;
             }
             else {
                 updateConstraintWeight();
-                randomWalkUnSat();
+                STATS_MOVE(RANDOM_WALK_UNSAT, (randomWalkUnSat(), true));
                 judgeRandomOp = true;
                 if (DEBUG && _options._printStep) cout << "Did Random Walk On UnSat" << endl;
                 randomUnSatCnt++;
             }
         }
 
-        if (JUDGE) judgeUnSatConstraint();
-        if (JUDGE) judgeCoefFreeValue();
+        if (JUDGE && _curStep % _options._judgeInterval == 0) judgeUnSatConstraint();
+        if (JUDGE && _curStep % _options._judgeInterval == 0) judgeCoefFreeValue();
         updateResult();
+        STATS(if (_curStep % 1024 == 0) reportStats(false));
 
         // displayBestSolution();
         if (DEBUG && _options._printStep) {
             displayObjectiveAssignment(true);
             displayNoneZeroAssignment();
-            cout << "Obj Value: " << calcPolyValue(_formula->getObjectiveFunction()) << "  Best: " << _bestObjectiveValue << endl;
+            cout << "Obj Value: " << (Float) calcPolyValue(_formula->getObjectiveFunction()) << "  Best: " << _bestObjectiveValue << endl;
             // if (_curStep % 10 == 0) getchar();
         }
     }
 }
 
 void LsSolver::newVersion() {
-    cout << "This is new Version" << endl;
+    if (_options._printResult) cout << "This is new Version" << endl;
     Int liftCnt = 0;
 
     for (_curStep = 0; _curStep < _options._maxStep; _curStep++) {
         if (DEBUG && _options._printStep) {
             cout << endl << "step: " << _curStep << ", ";
             cout << "#unsat: " << getUnSatConsCnt() << ", ";
-            cout << "Time: " << util::getSeconds(startTime) << endl;
+            cout << "Time: " << util::getSeconds(_startTime) << endl;
             cout << "Best Value: " << _bestObjectiveValue << endl;
         }
         if (checkOffFlag()) {
-            displayOffInfo();
-            displayBestSolution();
+            displayResult();
             return ;
         }
 
         // Main Search
         if (getSatState()) {    // SAT
-            if (doObjectiveBoundMove()) {
+            if (STATS_MOVE(OBJECTIVE_BOUND, doObjectiveBoundMove())) {
                 if (DEBUG && _options._printStep) cout << "Did Objective Bound Move" << endl;
             }
-            else if (doObjectiveTwoLevelMove()) {
+            else if (STATS_MOVE(OBJECTIVE_TWO_LEVEL, doObjectiveTwoLevelMove())) {
                 if (DEBUG && _options._printStep) cout << "Did Objective Two Level Move" << endl;
             }
-            else if (doSampleSatMove()) {
+            else if (STATS_MOVE(SAMPLE_SAT, doSampleSatMove())) {
                 if (DEBUG && _options._printStep) cout << "Did Objective Sample Move" << endl;
             }
             else { 
                 updateConstraintWeight();
                 // randomWalkSat();
-                if (!randomWalkSatOnObjVar()) {
-                    displayOffInfo();
-                    displayBestSolution();
+                if (!STATS_MOVE(RANDOM_WALK_SAT_OBJ, randomWalkSatOnObjVar())) {
+                    displayResult();
                     return;
                 }
                 if (DEBUG && _options._printStep) cout << "Did Random Walk On Sat" << endl;
             }
         }
         else {                  // UNSAT
-            if (doFeasibleUnSatOperator()) {
+            if (STATS_MOVE(FEASIBLE_UNSAT, doFeasibleUnSatOperator())) {
                 if (DEBUG && _options._printStep) cout << "Did feasible UnSat Op" << endl;
             }
             else {
                 updateConstraintWeight();
-                randomWalkUnSat();
+                STATS_MOVE(RANDOM_WALK_UNSAT, (randomWalkUnSat(), true));
                 if (DEBUG && _options._printStep) cout << "Did Random Walk On UnSat" << endl;
             }
         }
 
-        if (JUDGE) judgeUnSatConstraint();
-        if (JUDGE) judgeCoefFreeValue();
+        if (JUDGE && _curStep % _options._judgeInterval == 0) judgeUnSatConstraint();
+        if (JUDGE && _curStep % _options._judgeInterval == 0) judgeCoefFreeValue();
         updateResult();
+        STATS(if (_curStep % 1024 == 0) reportStats(false));
 
         // displayBestSolution();
         if (DEBUG && _options._printStep) {
             displayObjectiveAssignment(true);
             displayNoneZeroAssignment();
-            cout << "Obj Value: " << calcPolyValue(_formula->getObjectiveFunction()) << "  Best: " << _bestObjectiveValue << endl;
+            cout << "Obj Value: " << (Float) calcPolyValue(_formula->getObjectiveFunction()) << "  Best: " << _bestObjectiveValue << endl;
             // if (_curStep % 10 == 0) getchar();
         }
     }
 }
 
+#ifdef LS_STATS
+/**
+ * @brief final report at the end of solve(), periodic ones every _statsInterval seconds
+ */
+void LsSolver::reportStats(bool final) {
+    Float seconds = util::getSeconds(_startTime);
+    if (!final && seconds - _lastStatsTime < _options._statsInterval) return;
+    _lastStatsTime = seconds;
+    _stats.report(_options._statsFile, _threadIndex, _curStep, seconds, final);
+}
+#endif
+
 void LsSolver::solve(bool useNewVersion) {
     initSolver();
-    outputInfo(cout);
+    if (_options._printResult) outputInfo(cout);
+    STATS(_stats.clear());
+    STATS(_lastStatsTime = 0);
+
+    _curStep = 0;
+    updateResult();         // a warm start may already be the best assignment the search sees
 
     if (useNewVersion) newVersion();
     else oldVersion();
+
+    STATS(reportStats(true));
 }
 
 }
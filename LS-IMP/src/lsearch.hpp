@@ -1,12 +1,15 @@
+#pragma once
+
 #include "utils.hpp"
 #include "formula.hpp"
 #include "assignment.hpp"
+#include "stats.hpp"
 
 
 namespace LS_NIA {
 
 struct Options {
-    bool    _greedyInit;
+    bool    _greedyInit;                    // start from initGreedyAssignment instead of all 0
     Int     _bmsThreshold;
     Int     _maxStep;
     Float   _maxTime;                      // in second
@@ -21,6 +24,15 @@ struct Options {
     Int     _randomStep;                   // used for random walk
 
     bool    _printStep;                     // print for Debug
+    bool    _printResult;                   // print off info and best solution when search stops
+
+    Int     _seed;                          // seed of the solver's own random engine
+    Int     _randomStream;                  // jump index of the engine, distinct per portfolio thread
+    Int     _importStep;                    // import shared incumbent after _importStep steps without improvement
+    Int     _judgeInterval;                 // full recompute check every _judgeInterval steps, JUDGE only
+
+    string  _statsFile;                     // JSON lines report, stderr if empty, LS_STATS builds only
+    Float   _statsInterval;                 // seconds between periodic reports
 
     Options() {
         _greedyInit   = false;
@@ -40,33 +52,61 @@ struct Options {
         _randomStep   = 10;
 
         _printStep    = false;
+        _printResult  = true;
+
+        _seed         = DEFAULT_RANDOM_SEED;
+        _randomStream = 1;
+        _importStep   = 10000;
+        _judgeInterval = 1;
+
+        _statsFile     = "";
+        _statsInterval = 10;
     }
 };
 
+class SharedIncumbent;
+class Presolver;
+
 class LsSolver {
 protected:
     const NIA_Formula* _formula;
 
     Options         _options;
+    Random          _random;                    // per solver, no shared random state between threads
+    TimePoint       _startTime;
+
+    SharedIncumbent* _sharedIncumbent;          // nullptr if solved alone
+    const Presolver* _presolver;                // nullptr if the formula is not presolved, maps the printed assignment back
+    Int             _threadIndex;
+    uint64_t        _importedVersion;           // last incumbent version seen
+    Int             _lastImproveStep;           // step of last best improvement
     Variable        _varCnt;
     Int             _consCnt;
     Assignment      _assignment;
+    vector<Int>     _initValues;                // warm start, .at(var) = initial value clamped to its bounds, empty: all 0
 
     vector<Variable> _objectiveVars;
+    vector<Float>   _objCoefOnVar;              // .at(var) = coefficient of var in the (linear) objective, 0 if absent
+    IndexedSet      _objectiveVarSet;           // vars of _objectiveVars
+    IndexedSet      _unBoundedObjVars;          // objective vars below their upper bound, kept in setVarWithNewVal
 
-    Float           _curObjectiveValue;
-    vector<Float>   _consValue;                 // cons.poly value on current assignment ??? Float ?
+    Float           _curObjectiveValue;         // kept by delta in setVarWithNewVal
+    // every constraint is kept as value <= limit, a >= constraint is negated: value, limit and coefficients times -1
+    vector<Num>     _consValue;                 // _consDir * cons.poly value on current assignment, exact
     vector<Float>   _consWeight;                // cons weight used for hard score
+    vector<Int>     _consLimit;                 // .at(consIndex) = _consDir * cons.getLimit(), sat iff value <= limit
+    vector<Int>     _consDir;                   // +1 for <=, -1 for >=
 
     OperatorPool    _operatorPool;
 
-    Set<Int>        _unSatConstraint;           // store unsat Constraint Index
+    IndexedSet      _unSatConstraint;           // store unsat Constraint Index
+    IndexedSet      _slackConstraint;           // store Constraint Index with _consValue != limit, kept in setVarWithNewVal
+    IndexedSet      _visitedCons;               // scratch, constraints already expanded in one operator pool build
     // Set<Int>        _unBndConstraint;           // store unbounded Constraint Index
 
     Int             _curStep;
     vector<Int>     _tabuStepOnVar;             // store tabu step on var;
 
-    vector<vector<Int> > _var2ConsIndex;        // .at(var).at(i) is constraint Index
 
     Assignment      _bestAssignment;            // store best assignment
     Float           _bestObjectiveValue;        // store best objective value
@@ -75,17 +115,59 @@ protected:
     Float           _objectWeight;              // used for soft score
 
     Variable        _debugVar;                  // for debug
+
+#ifdef LS_STATS
+    SearchStats     _stats;
+    Float           _lastStatsTime;             // seconds of the last periodic report
+    void reportStats(bool final);
+#endif
     // vector<Float>   _constraintWeight;          // used for hard score
 
-    // bool                    _useCoef = true;       // use coef or freeTerm
-    vector<Set<unsigned> >  _consVarSet;           // .at(consIndex) = variables appear in consIndex
-    vector<Map<unsigned, Float> > _consCoefOnVar;  // .at(consIndex).at(var) = coefficient of var in cons.at(consIndex)
-    // vector<Map<unsigned, Float> > _consFreeOnVar;  // .at(consIndex).at(var) = free term of var in cons.at(consIndex)
+    // constraint / variable incidence in CSR form, a slot is one (consIndex, var) pair
+    // slots of a constraint are contiguous and sorted by var
+    vector<Int>      _consSlotBegin;            // slots of consIndex are [.at(consIndex), .at(consIndex + 1))
+    vector<Variable> _slotVar;                  // .at(slot) = var
+    vector<Int>      _slotCons;                 // .at(slot) = consIndex
+    vector<Num>      _slotCoef;                 // .at(slot) = _consDir * coefficient of var in cons.at(consIndex)
+    vector<Int>      _varSlotBegin;             // slots of var are _varSlot[.at(var), .at(var + 1)), ascending consIndex
+    vector<Int>      _varSlot;
+
+    // slots of var grouped by kind, every group is run by the kernel of its kind, see SlotKind
+    enum SlotKind { LINEAR_SLOT, NONLINEAR_SLOT, FACTORED_SLOT, SLOT_KIND_CNT };
+    vector<Int>      _varKindSlotBegin;         // kind slots of var are _varKindSlot[.at(var * SLOT_KIND_CNT + kind), .at(var * SLOT_KIND_CNT + kind + 1))
+    vector<Int>      _varKindSlot;              // ascending consIndex inside a group
+
+    // occurrence index of the nonlinear monomials (terms) of POLYNOMIAL constraints, empty for linear and factored ones
+    vector<Int>      _termSlotBegin;            // slots of the vars of term are _termSlot[.at(term), .at(term + 1)), in var order, a power repeats its slot
+    vector<Int>      _termSlot;
+    vector<Num>      _termCoef;                 // .at(term) = _consDir * coefficient of the monomial
+    vector<Int>      _slotTermBegin;            // terms containing the slot var are _slotTerm[.at(slot), .at(slot + 1)), ascending
+    vector<Int>      _slotTerm;
+    IndexedSet       _pendingSlot;              // scratch of isMoveInRange, slots whose coefficient the move changes
+    vector<WideNum>  _pendingCoef;              // .at(slot) = coefficient after the move, valid iff in _pendingSlot
+
+    // scratch of the batch scoring in selectOperatorAndMove, kept across steps
+    // a row is one (sampled operator, slot of its var), rows of an operator are contiguous
+    vector<Variable> _smpVar;
+    vector<Int>      _smpVal;
+    vector<Float>    _smpScore;
+    vector<Int>      _rowSmp;                   // .at(row) = index of the sampled operator
+    vector<Int>      _rowCons;
+    vector<Num>      _rowPre;                   // cons value before / after the move, saturated as compared by isSatValue
+    vector<Num>      _rowPost;
+    vector<Int>      _rowTrans;                 // +1 unsat -> sat, -1 sat -> unsat, 0 otherwise
+
+    // factored constraints keep the value of every linear factor, coefficients are derived in O(1)
+    vector<Int>      _consFactorBase;           // .at(consIndex) = offset of its factors in _factorValue, -1 if not factored
+    vector<Num>      _factorValue;              // value of the linear factors on current assignment
+    vector<Int>      _slotFactorBase;           // .at(slot) = offset of var's factor coefficients in _slotFactorCoef, -1 if not factored
+    vector<Num>      _slotFactorCoef;           // coefficient of var in each factor of its constraint
 
     void outputInfo(ostream &out) const;
     bool checkOffFlag() const;
 
     void displayOffInfo() const;
+    void displayResult() const;
     void displayBestSolution() const;
     void displayObjectiveAssignment(bool onlyUnBounded = false) const;
     void displayNoneZeroAssignment() const;
@@ -96,33 +178,61 @@ protected:
     void initAssignment();
     void initBestAssignment();
     void initAssignmentBound();
+    void initGreedyAssignment();
     void initConsValue();
     void initConsWeight();
     void initTabuStep();
-    void initConsVarInfo();         // init _var2ConsIndex _consVarSet
+    void initConsVarInfo();         // init slots _consSlotBegin _varSlotBegin
+    void initConsTermInfo();        // init terms _termSlotBegin _slotTermBegin
+    void initVarKindSlot();         // init slot groups _varKindSlotBegin
     void initUnSatConstraint();
     void initConsCoef();
     void initDebugVar() {_debugVar = Variable::undef;}      // for DEBUG
     // void initDebugVar() {_debugVar = 5180u;}      // for DEBUG
 
-    Float calcConsValue(const Constraint& cons) const;
-    Float calcPolyValue(const Polynomial& poly) const;
-    Float calcConsValueExVar(const Constraint& cons, const Variable& exVar) const;
-    Float calcMonomialValue(const Monomial& mono) const;
-    Float calcMonomialValueExVar(const Monomial& mono, const Variable& exVar) const;
-    Float calcVarCoefOnPoly(const Polynomial& poly, const Variable& exVar) const;
-    Float calcVarCoefOnMono(const Monomial& mono, const Variable& exVar) const;
-
-    Pair<Float, Float> clacVarInfoInCons(const Int& consIndex, const Variable& exVar) const;
+    // full recompute from the formula, exact in integer builds
+    WideNum calcConsValue(const Constraint& cons) const;
+    WideNum calcPolyValue(const Polynomial& poly) const;
+    WideNum calcConsValueExVar(const Constraint& cons, const Variable& exVar) const;
+    WideNum calcPolyValueExVar(const Polynomial& poly, const Variable& exVar) const;
+    WideNum calcVarCoefOnCons(const Constraint& cons, const Variable& exVar) const;
+    WideNum calcMonomialValue(const MonomialRef& mono) const;
+    WideNum calcMonomialValueExVar(const MonomialRef& mono, const Variable& exVar) const;
+    WideNum calcVarCoefOnPoly(const Polynomial& poly, const Variable& exVar) const;
+    WideNum calcVarCoefOnMono(const MonomialRef& mono, const Variable& exVar) const;
+
+    Pair<Num, WideNum> clacVarInfoInCons(const Int& slot) const;
+
+    inline Int getConsSlotCnt(Int consIndex) const { return _consSlotBegin[consIndex + 1] - _consSlotBegin[consIndex]; }
+    inline Int getVarConsCnt(const Variable& var) const { return _varSlotBegin[var + 1] - _varSlotBegin[var]; }
+    Int getSlot(Int consIndex, const Variable& var) const;
+
+    inline Num getSlotCoef(Int slot) const { return _slotFactorBase[slot] < 0 ? _slotCoef[slot] : calcFactoredSlotCoef(slot); }
+    inline Num getSlotFormulaCoef(Int slot) const { return _consDir[_slotCons[slot]] * getSlotCoef(slot); }    // sign as in the formula
+    Num calcFactoredSlotCoef(Int slot) const;
+    template <SlotKind kind>
+    inline Num getKindSlotCoef(Int slot) const { return kind == FACTORED_SLOT ? calcFactoredSlotCoef(slot) : _slotCoef[slot]; }
 
     void addUnSatConstraint(Int consIndex);
     void delUnSatConstraint(Int consIndex);
-    inline bool isUnSatConstraint(Int consIndex) const { return _unSatConstraint.count(consIndex) > 0; }
+    inline bool isUnSatConstraint(Int consIndex) const { return _unSatConstraint.contains(consIndex); }
     inline Int  getUnSatConsCnt() const { return _unSatConstraint.size(); }
+    inline void updateUnBoundedObjVar(const Variable& var) {
+        if (getVarAssign(var) != getVarUB(var)) _unBoundedObjVars.insert(var);
+        else _unBoundedObjVars.erase(var);
+    }
+    void initUnBoundedObjVars();
+    inline bool isTabu(const Variable& var) const { return _options._tabuFlag && _curStep < _tabuStepOnVar[var]; }
+
+    inline bool isSlackConstraint(Int consIndex) const { return _slackConstraint.contains(consIndex); }
+    inline void updateSlackConstraint(Int consIndex) {
+        if (_consValue[consIndex] != _consLimit[consIndex]) _slackConstraint.insert(consIndex);
+        else _slackConstraint.erase(consIndex);
+    }
     
     bool judgeUnSatConstraint() const;
     bool judgeCoefFreeValue() const;
-    bool judgeLimitOpVal(Int limit, Op op, Int val) const;
+    inline bool isSatValue(Int consIndex, Num val) const { return val <= _consLimit[consIndex]; }
     
     inline bool getSatState() const { return _unSatConstraint.size() == 0; }
 
@@ -135,10 +245,10 @@ protected:
     Int  liftObjectiveFunctionOnVar(const Variable& var, bool findMax);
 
     Int  findFeasibleVarValue(const Variable& var, bool findMax);
-    Int  findFeasibleVarValueOnCons(const Variable& var, const Int consIndex, bool findMax);     // Bounded Value
+    Int  findFeasibleVarValueOnSlot(const Int slot, bool findMax);     // Bounded Value
     // Int  findBoundedVarValueOnCons(const Variable& var, const Constraint& cons, bool findMax);
 
-    inline bool couldCalc(Op op, Int coef, bool findMax) const;
+    inline bool couldCalc(Num coef, bool findMax) const;
     inline bool checkOperator(Variable var, Int val) const;
     
     void insertOperatorOnCons(const Int consIndex);
@@ -156,32 +266,49 @@ protected:
     bool doObjectiveTwoLevelMove();
     bool doSampleSatMove();
 
-    bool isFactor(const Polynomial& poly, unsigned var1, unsigned var2) const;
+    bool isFactor(Int slot1, Int slot2) const;
 
     bool selectOperatorAndMove(Float minScore);
 
     Float clacScore( Variable var, Int val) const { return clacHardScore(var, val) + clacSoftScore(var, val); }  
     Float clacHardScore( Variable var, Int val) const;
     Float clacSoftScore( Variable var, Int val) const;
+    void  clacScoreBatch(Int smpCnt);          // _smpScore[i] = clacScore(_smpVar[i], _smpVal[i])
+    template <SlotKind kind>
+    Int   gatherKindRows(Int smpIndex, Int row);   // rows of the kind slots of _smpVar[smpIndex], returns the next row
 
     void randomWalkSat();
     bool randomWalkSatOnObjVar();
     void randomWalkUnSat();
-    void randomWalkOnCons(const Constraint& cons);
+    void randomWalkOnCons(Int consIndex);
 
-    void setVarWithNewVal(const Variable& var, Int val);       // move
-    void updateConsInfo(const Int& consIndex, const Variable& var, const Int& val);       // update _consFactorOnVar
+    bool setVarWithNewVal(const Variable& var, Int val);       // move, false if rejected by isMoveInRange
+    bool isMoveInRange(const Variable& var, Int val);          // every stored value fits a Num after the move
+    template <SlotKind kind>
+    void updateConsInfo(const Int& slot, const Int& delta);       // update _consValue _slotCoef
 
     void updateConstraintWeight();
     bool updateResultJudge();
     void updateResult();
 
+    void resetAssignment(const vector<Int>& values);       // restart from values, clamped to bounds
+    bool importSharedIncumbent();
+
     void oldVersion();
     void newVersion();
 
 public:
-    LsSolver(const NIA_Formula& formula) { _formula = &formula; };
+    LsSolver(const NIA_Formula& formula, const Options& options = Options());
     void solve(bool useNewVersion = true);
+
+    inline void setSharedIncumbent(SharedIncumbent* sharedIncumbent, Int threadIndex) { _sharedIncumbent = sharedIncumbent; _threadIndex = threadIndex; }
+    inline Int  getCurStep() const { return _curStep; }
+    inline void setPresolver(const Presolver* presolver) { _presolver = presolver; }
+
+    inline void  setInitValues(const vector<Int>& values) { _initValues = values; }
+    inline Int   getBestUnSatConsNum() const { return _bestUnSatConsNum; }
+    inline Float getBestObjectiveValue() const { return _bestObjectiveValue; }
+    void getBestValues(vector<Int>& values) const;
 };
 
 
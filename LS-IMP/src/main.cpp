@@ -1,9 +1,57 @@
 #include "instacne.hpp"
 #include "lsearch.hpp"
+#include "portfolio.hpp"
+#include "serialize.hpp"
+#include "batch.hpp"
+#include "presolve.hpp"
 #include <cstring>
 
 bool readLpFile = false;
+string dumpFormulaPath;           // write compiled formula and exit
+string loadFormulaPath;           // solve a compiled formula, no input files needed
+string querySpec;                 // batch of query demands, "all" or comma separated demand IDs
+string initPath;                  // warm start from a solution file
+string solutionPath;              // write the best assignment as a solution file
+bool presolve = false;               // reduce the formula before search, solutions are mapped back
 bool useNewVersion = true;
+Int  niaNum = NIA_NUM;
+Int  threadCnt = 0;                 // 0: one solver without portfolio
+Int  readThreadCnt = 1;
+LS_NIA::Options options;
+
+void solveFormula(const LS_NIA::NIA_Formula& originFormula) {
+    vector<Int> initValues;
+    if (!initPath.empty()) initValues = LS_NIA::SolutionFile::read(originFormula, initPath);
+
+    LS_NIA::Presolver   presolver(originFormula);
+    LS_NIA::NIA_Formula reducedFormula;
+    if (presolve) {
+        reducedFormula = presolver.presolve();
+        if (!initValues.empty()) initValues = presolver.presolveValues(initValues);
+    }
+    const LS_NIA::NIA_Formula& formula = presolve ? reducedFormula : originFormula;
+
+    vector<Int> bestValues;
+    if (threadCnt > 0) {
+        LS_NIA::Portfolio portfolio(formula, options, threadCnt);
+        if (!initValues.empty()) portfolio.setInitValues(initValues);
+        if (presolve) portfolio.setPresolver(&presolver);
+        portfolio.solve(useNewVersion);
+        Int   unSatConsNum;
+        Float objectiveValue;
+        portfolio.getBest(bestValues, unSatConsNum, objectiveValue);
+    } else {
+        LS_NIA::LsSolver solver(formula, options);
+        if (!initValues.empty()) solver.setInitValues(initValues);
+        if (presolve) solver.setPresolver(&presolver);
+        solver.solve(useNewVersion);
+        solver.getBestValues(bestValues);
+    }
+
+    if (solutionPath.empty()) return;
+    if (presolve && !bestValues.empty()) bestValues = presolver.postsolve(bestValues);
+    LS_NIA::SolutionFile::write(originFormula, bestValues, solutionPath);
+}
 
 int main(int argc, char** argv) {
     util::setRandom(DEFAULT_RANDOM_SEED);
@@ -18,28 +66,94 @@ int main(int argc, char** argv) {
         if (strcmp(argv[i], "--ov") == 0) {
             useNewVersion = false;
         }
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {     // time limit in second
+            options._maxTime = std::stold(argv[++i]);
+        }
+        if (strcmp(argv[i], "--nia") == 0 && i + 1 < argc) {      // NIA constraint num
+            niaNum = std::stoi(argv[++i]);
+        }
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {  // portfolio solver threads
+            threadCnt = std::stoi(argv[++i]);
+        }
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {     // master seed of reader and solvers
+            options._seed = std::stoll(argv[++i]);
+            util::setRandom(options._seed);
+        }
+        if (strcmp(argv[i], "--read-threads") == 0 && i + 1 < argc) {  // threads parsing the sample file
+            readThreadCnt = std::stoi(argv[++i]);
+        }
+        if (strcmp(argv[i], "--dump-formula") == 0 && i + 1 < argc) {
+            dumpFormulaPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--load-formula") == 0 && i + 1 < argc) {
+            loadFormulaPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {           // JSON lines stats report, needs -DLS_STATS=ON
+            options._statsFile = argv[++i];
+        }
+        if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc) {  // seconds between periodic stats reports
+            options._statsInterval = std::stold(argv[++i]);
+        }
+        if (strcmp(argv[i], "--import-step") == 0 && i + 1 < argc) {  // steps without improvement before importing incumbent
+            options._importStep = std::stoi(argv[++i]);
+        }
+        if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {      // one result row per query demand, --time is per query
+            querySpec = argv[++i];
+        }
+        if (strcmp(argv[i], "--greedy") == 0) {                      // constructive start, demands filled by scarcity
+            options._greedyInit = true;
+        }
+        if (strcmp(argv[i], "--presolve") == 0) {                    // bound propagation, fixing and row elimination
+            presolve = true;
+        }
+        if (strcmp(argv[i], "--init") == 0 && i + 1 < argc) {         // initial assignment, clamped to the bounds
+            initPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--write-solution") == 0 && i + 1 < argc) {
+            solutionPath = argv[++i];
+        }
+        if (strcmp(argv[i], "--bms") == 0 && i + 1 < argc) {          // operators sampled and scored per selection
+            options._bmsThreshold = std::stoi(argv[++i]);
+        }
     }
 
-    if (readLpFile) {
-        LS_NIA::NIA_Formula formula = LS_NIA::lpReader::readLpFile(argv[argc - 1]);
+#ifndef LS_STATS
+    if (!options._statsFile.empty()) util::showWarning("--stats ignored, built without LS_STATS");
+#endif
+    if (!querySpec.empty() && (readLpFile || !loadFormulaPath.empty() || !dumpFormulaPath.empty()))
+        util::showError("--queries needs demand and sample files");
+    if (!querySpec.empty() && (!initPath.empty() || !solutionPath.empty()))
+        util::showError("--init and --write-solution solve a single query");
 
-        startTime = util::getTimePoint();
-        LS_NIA::LsSolver solver(formula);
-
-        solver.solve(useNewVersion);
+    LS_NIA::NIA_Formula formula;
+    if (!loadFormulaPath.empty()) {
+        formula = LS_NIA::FormulaCache::load(loadFormulaPath);
+    }
+    else if (readLpFile) {
+        formula = LS_NIA::lpReader::readLpFile(argv[argc - 1]);
     } else {
         LS_NIA::Instance instance;
-        
+        instance.setNiaNum(niaNum);
+        instance.setReadThreadCnt(readThreadCnt);
+
         instance.readDemandFile(argv[argc - 2]);
         instance.readSampleFile(argv[argc - 1]);
 
-        LS_NIA::NIA_Formula formula = instance.genFormula();
+        if (!querySpec.empty()) {
+            startTime = util::getTimePoint();
+            LS_NIA::QueryBatch batch(instance, options, threadCnt, presolve);
+            batch.solve(LS_NIA::QueryBatch::parseQueries(instance, querySpec), useNewVersion);
+            return 0;
+        }
 
-        startTime = util::getTimePoint();
-        LS_NIA::LsSolver solver(formula);
+        formula = instance.genFormula();
+    }
 
-        solver.solve(useNewVersion);
+    if (!dumpFormulaPath.empty()) {
+        LS_NIA::FormulaCache::dump(formula, dumpFormulaPath);
+        return 0;
     }
 
-   
-}
\ No newline at end of file
+    startTime = util::getTimePoint();
+    solveFormula(formula);
+}
@@ -0,0 +1,109 @@
+#include "portfolio.hpp"
+#include "presolve.hpp"
+
+namespace LS_NIA {
+
+SharedIncumbent::SharedIncumbent(Int consCnt) 
+    : _version(0), _unSatConsNum(consCnt + 1), _objectiveValue(std::numeric_limits<double>::infinity()),
+      _bestObjectiveValue(-NEGATIVE_INFINITY), _bestThread(-1), _startTime(util::getTimePoint()), _presolver(nullptr) {}
+
+/**
+ * @brief store assignment if it is better than the current incumbent
+ *        one line per improvement, used for time-to-target curves
+ */
+bool SharedIncumbent::publish(Int unSatConsNum, Float objectiveValue, const Assignment& assignment, Int threadIndex) {
+    if (!isBetter(unSatConsNum, objectiveValue)) return false;     // lock free reject
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!isBetter(unSatConsNum, objectiveValue, _unSatConsNum.load(), _bestObjectiveValue)) return false;
+
+    Int varCnt = assignment.varCnt();
+    _bestValues.resize(varCnt);
+    for (Int var = 0; var < varCnt; var++) _bestValues[var] = assignment.getVal(Variable(var));
+
+    _bestObjectiveValue = objectiveValue;
+    _bestThread         = threadIndex;
+    _objectiveValue.store(objectiveValue, std::memory_order_relaxed);
+    _unSatConsNum.store(unSatConsNum, std::memory_order_relaxed);
+    _version.fetch_add(1, std::memory_order_release);
+
+    cout << "#incumbent: " << util::getSeconds(_startTime) << " " << unSatConsNum << " " << objectiveValue << " " << threadIndex << endl;
+    return true;
+}
+
+bool SharedIncumbent::fetch(vector<Int>& values, Int& unSatConsNum, Float& objectiveValue, uint64_t& version) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_bestValues.empty()) return false;
+
+    values         = _bestValues;
+    unSatConsNum   = _unSatConsNum.load();
+    objectiveValue = _bestObjectiveValue;
+    version        = _version.load();
+    return true;
+}
+
+void SharedIncumbent::displayBestSolution() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    cout << "#time: " << util::getSeconds(_startTime) << endl;
+    if (_unSatConsNum == 0) cout << " ***** SAT ***** " << endl;
+    else cout << " ***** UNSAT *****    Best Unsat Cons Num: " << _unSatConsNum << endl;
+    cout << "Best Value: " << _bestObjectiveValue << "  (thread " << _bestThread << ")" << endl;
+    cout << " ***** Best Assignment ******\n";
+    if (_presolver != nullptr && !_bestValues.empty()) _presolver->displayAssignment(cout, _bestValues);
+    else {
+        for (Int var = 0, size = _bestValues.size(); var < size; var++) {
+            cout << var << " = " << _bestValues[var] << endl;
+        }
+    }
+    if (_unSatConsNum == 0)
+        cout << "ObjectiveFuntion Value: " << _bestObjectiveValue << endl;
+    else cout << "ObjectiveFuntion Value: inf" << endl;
+}
+
+Portfolio::Portfolio(const NIA_Formula& formula, const Options& options, Int threadCnt)
+    : _formula(&formula), _options(options), _threadCnt(threadCnt), _incumbent(formula.getConsCnt()) {
+    assert(_threadCnt > 0);
+}
+
+/**
+ * @brief thread 0 runs the given options, the others vary random stream, BMS size and tabu tenure
+ * 
+ */
+Options Portfolio::genThreadOptions(Int threadIndex) const {
+    static const Int bmsThreshold[] = {100, 50, 200, 400};
+    static const Int tabuConst[]    = {3, 1, 5, 10};
+
+    Options options = _options;
+    options._randomStream = _options._randomStream + threadIndex;
+    options._printResult = false;
+    if (threadIndex > 0) {
+        options._bmsThreshold = bmsThreshold[threadIndex % 4];
+        options._tabuConst    = tabuConst[(threadIndex / 4) % 4];
+    }
+    return options;
+}
+
+void Portfolio::solve(bool useNewVersion) {
+    vector<std::thread> threads;
+    vector<Int>         steps(_threadCnt, 0);
+    for (Int threadIndex = 0; threadIndex < _threadCnt; threadIndex++) {
+        Options options = genThreadOptions(threadIndex);
+        threads.push_back(std::thread([this, options, threadIndex, useNewVersion, &steps]() {
+            LsSolver solver(*_formula, options);
+            solver.setSharedIncumbent(&_incumbent, threadIndex);
+            if (!_initValues.empty()) solver.setInitValues(_initValues);
+            solver.solve(useNewVersion);
+            steps[threadIndex] = solver.getCurStep();
+        }));
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    if (!_options._printResult) return;
+    Int totalStep = 0;
+    for (Int step : steps) totalStep += step;
+    cout << "#threads: " << _threadCnt << endl;
+    cout << "#step: " << totalStep << endl;
+    _incumbent.displayBestSolution();
+}
+
+} // namespace LS_NIA
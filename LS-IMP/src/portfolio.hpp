@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "utils.hpp"
+#include "formula.hpp"
+#include "assignment.hpp"
+#include "lsearch.hpp"
+
+namespace LS_NIA {
+
+/**
+ * @brief best (unsat num, objective value, assignment) found by any solver thread
+ *        isBetter() reads atomics only, publish() / fetch() take the lock
+ */
+class SharedIncumbent {
+protected:
+    std::mutex            _mutex;
+    std::atomic<uint64_t> _version;           // bumped on every improvement
+    std::atomic<Int>      _unSatConsNum;      // hint for lock free compare
+    std::atomic<double>   _objectiveValue;    // hint for lock free compare
+
+    Float       _bestObjectiveValue;          // exact, guarded by _mutex
+    vector<Int> _bestValues;                  // .at(var) = value, guarded by _mutex
+    Int         _bestThread;
+    TimePoint   _startTime;
+    const Presolver* _presolver;              // nullptr if the formula is not presolved
+
+    static inline bool isBetter(Int unSat, Float value, Int bestUnSat, Float bestValue) {
+        return unSat < bestUnSat || (unSat == bestUnSat && value < bestValue);
+    }
+public:
+    SharedIncumbent(Int consCnt);
+
+    inline uint64_t getVersion() const { return _version.load(std::memory_order_acquire); }
+    inline Int      getUnSatConsNum() const { return _unSatConsNum.load(std::memory_order_relaxed); }
+    inline bool     isBetter(Int unSat, Float value) const { 
+        return isBetter(unSat, value, getUnSatConsNum(), _objectiveValue.load(std::memory_order_relaxed)); 
+    }
+
+    bool publish(Int unSatConsNum, Float objectiveValue, const Assignment& assignment, Int threadIndex);
+    bool fetch(vector<Int>& values, Int& unSatConsNum, Float& objectiveValue, uint64_t& version);
+
+    inline void setPresolver(const Presolver* presolver) { _presolver = presolver; }
+    void displayBestSolution();
+};
+
+/**
+ * @brief N LsSolver threads on one read only formula, different seeds and options
+ * 
+ */
+class Portfolio {
+protected:
+    const NIA_Formula* _formula;
+    Options            _options;
+    Int                _threadCnt;
+    SharedIncumbent    _incumbent;
+    vector<Int>        _initValues;       // warm start of every thread, empty: all 0
+
+    Options genThreadOptions(Int threadIndex) const;
+public:
+    Portfolio(const NIA_Formula& formula, const Options& options, Int threadCnt);
+    void solve(bool useNewVersion = true);
+
+    inline void setInitValues(const vector<Int>& values) { _initValues = values; }
+    inline void setPresolver(const Presolver* presolver) { _incumbent.setPresolver(presolver); }
+    inline bool getBest(vector<Int>& values, Int& unSatConsNum, Float& objectiveValue) {
+        uint64_t version;
+        return _incumbent.fetch(values, unSatConsNum, objectiveValue, version);
+    }
+};
+
+} // namespace LS_NIA
@@ -0,0 +1,292 @@
+#include "presolve.hpp"
+
+#include <map>
+
+namespace LS_NIA {
+
+const Int Presolver::undef = -1;
+
+static const Float INF = std::numeric_limits<Float>::infinity();
+static const Float EPS = 1e-9;
+
+Presolver::Presolver(const NIA_Formula& formula)
+    : _formula(&formula), _varCnt(formula.getVarCnt()), _infeasible(false), _newVarCnt(0) {}
+
+void Presolver::setIdentity() {
+    _newVar.resize(_varCnt);
+    _fixedValue.assign(_varCnt, 0);
+    for (Int var = 0; var < _varCnt; var++) _newVar[var] = var;
+    _newVarCnt = _varCnt;
+}
+
+/**
+ * @brief linear rows in <= form, vars of every other row and of the objective are kept
+ */
+void Presolver::initRows() {
+    _keepVar.assign(_varCnt, false);
+    const vector<Constraint>& consVec = _formula->getConsVec();
+    for (Int consIndex = 0, consCnt = consVec.size(); consIndex < consCnt; consIndex++) {
+        const Constraint& cons = consVec[consIndex];
+        if (cons.getOp() != Op::LEQUAL && cons.getOp() != Op::GEQUAL) util::showError("Un except Op in presolve");
+
+        if (!cons.isLinear()) {
+            const vector<Polynomial>& polys = cons.isFactored() ? cons.getFactors() : vector<Polynomial>(1, cons.getPolynomial());
+            for (const Polynomial& poly : polys) {
+                for (const MonomialRef& mono : poly.getMonoVec()) {
+                    for (const Variable& var : mono.getVars()) _keepVar[var] = true;
+                }
+            }
+            continue;
+        }
+
+        Row row;
+        row._consIndex = consIndex;
+        row._negated   = cons.getOp() == Op::GEQUAL;
+        Float sign     = row._negated ? -1 : 1;
+        row._limit     = sign * cons.getLimit();        // Int limit, as the solver compares it
+        for (const MonomialRef& mono : cons.getMonoVec()) {
+            row._terms.push_back(Pair<Int, Float>(mono.getVars()[0], sign * mono.getCoef()));
+        }
+        _rows.push_back(row);
+    }
+    for (const MonomialRef& mono : _formula->getObjectiveFunction().getMonoVec()) {
+        for (const Variable& var : mono.getVars()) _keepVar[var] = true;
+    }
+}
+
+/**
+ * @brief sum a * x <= b: x_j <= (b - minimum of the other terms) / a_j for a_j > 0, >= for a_j < 0
+ *        a term with an infinite minimum only bounds itself
+ */
+bool Presolver::propagateRow(const Row& row) {
+    Float minAct = 0;
+    Int   infCnt = 0;
+    for (const Pair<Int, Float>& term : row._terms) {
+        Float bound = term.second > 0 ? _lb[term.first] : _ub[term.first];
+        if (bound == INF) infCnt++;
+        else minAct += term.second * bound;
+    }
+    if (infCnt > 1) return false;
+
+    bool changed = false;
+    for (const Pair<Int, Float>& term : row._terms) {
+        Int   var   = term.first;
+        Float coef  = term.second;
+        Float bound = coef > 0 ? _lb[var] : _ub[var];
+        Float rest;
+        if (bound == INF) rest = minAct;
+        else if (infCnt == 0) rest = minAct - coef * bound;
+        else continue;
+
+        Float slack = row._limit - rest;
+        if (coef > 0) {
+            Float ub = std::floor(slack / coef + EPS);
+            if (ub < _ub[var]) _ub[var] = ub, changed = true;
+        }
+        else {
+            Float lb = std::ceil(slack / coef - EPS);
+            if (lb > _lb[var]) _lb[var] = lb, changed = true;
+        }
+        if (_lb[var] > _ub[var]) _infeasible = true;
+    }
+    return changed;
+}
+
+void Presolver::propagate() {
+    for (Int pass = 0; pass < MAX_PASS && !_infeasible; pass++) {
+        bool changed = false;
+        for (const Row& row : _rows) changed |= propagateRow(row);
+        if (!changed) break;
+    }
+}
+
+/**
+ * @brief drop the removed vars of row into its limit
+ *        emptied, singleton (its bound is already in _lb / _ub) and never binding rows are dropped
+ */
+bool Presolver::reduceRow(Row& row) const {
+    vector<Pair<Int, Float> > terms;
+    for (const Pair<Int, Float>& term : row._terms) {
+        if (_newVar[term.first] == undef) row._limit -= term.second * _fixedValue[term.first];
+        else terms.push_back(term);
+    }
+    row._terms.swap(terms);
+    if (row._terms.size() <= 1) return false;
+
+    Float maxAct = 0;
+    for (const Pair<Int, Float>& term : row._terms) {
+        maxAct += term.second * (term.second > 0 ? _ub[term.first] : _lb[term.first]);
+    }
+    return !(maxAct <= row._limit + EPS);
+}
+
+Polynomial Presolver::renamePolynomial(const Polynomial& poly) const {
+    Polynomial res;
+    vector<Variable> vars;
+    for (const MonomialRef& mono : poly.getMonoVec()) {
+        vars.clear();
+        for (const Variable& var : mono.getVars()) {
+            if (JUDGE) assert(_newVar[var] != undef);
+            vars.push_back(Variable(_newVar[var]));
+        }
+        res.pushBack(vars.data(), vars.size(), mono.getCoef());
+    }
+    res.normalized();
+    return res;
+}
+
+NIA_Formula Presolver::genReducedFormula(const vector<bool>& keepRow) {
+    const vector<Constraint>& consVec = _formula->getConsVec();
+    vector<Int> rowOfCons(consVec.size(), undef);
+    for (Int i = 0, size = _rows.size(); i < size; i++) rowOfCons[_rows[i]._consIndex] = i;
+
+    NIA_Formula res;
+    for (Int consIndex = 0, consCnt = consVec.size(); consIndex < consCnt; consIndex++) {
+        const Constraint& cons = consVec[consIndex];
+        Int rowIndex = rowOfCons[consIndex];
+        if (rowIndex == undef) {
+            if (cons.isFactored()) {
+                const vector<Polynomial>& factors = cons.getFactors();
+                res.addFactoredConstraint(renamePolynomial(factors[0]), renamePolynomial(factors[1]),
+                                          renamePolynomial(factors[2]), renamePolynomial(factors[3]), cons.getOp(), cons.getLimit());
+            }
+            else res.addConstraint(renamePolynomial(cons.getPolynomial()), cons.getOp(), cons.getLimit());
+            continue;
+        }
+        if (!keepRow[rowIndex]) continue;
+
+        const Row& row = _rows[rowIndex];
+        Float sign = row._negated ? -1 : 1;
+        Polynomial poly;
+        poly.reserve(row._terms.size(), row._terms.size());
+        for (const Pair<Int, Float>& term : row._terms) poly.pushBack(Variable(_newVar[term.first]), sign * term.second);
+        res.addConstraint(std::move(poly), row._negated ? Op::GEQUAL : Op::LEQUAL, sign * row._limit);
+    }
+    res.addObjectiveFunction(renamePolynomial(_formula->getObjectiveFunction()));
+    res.setVarCnt(_newVarCnt);
+
+    const vector<string>& varNames = _formula->getVarNames();
+    vector<string> newNames;
+    vector<Int>    lb(_newVarCnt), ub(_newVarCnt);
+    if (!varNames.empty()) newNames.resize(_newVarCnt);
+    for (Int var = 0; var < _varCnt; var++) {
+        Int newVar = _newVar[var];
+        if (newVar == undef) continue;
+        if (!varNames.empty()) newNames[newVar] = varNames[var];
+        lb[newVar] = _lb[var];
+        ub[newVar] = _ub[var] == INF ? DUMMY_MAX_INT : (Int) _ub[var];
+    }
+    res.setVarNames(newNames);
+    res.setVarBounds(lb, ub);
+    return res;
+}
+
+NIA_Formula Presolver::presolve() {
+    TimePoint presolveTime = util::getTimePoint();
+
+    _lb.resize(_varCnt);
+    _ub.resize(_varCnt);
+    for (Int var = 0; var < _varCnt; var++) {
+        _lb[var] = _formula->hasVarBounds() ? std::max<Int>(_formula->getVarLB(Variable(var)), 0) : 0;
+        _ub[var] = _formula->hasVarBounds() && _formula->getVarUB(Variable(var)) != DUMMY_MAX_INT ? _formula->getVarUB(Variable(var)) : INF;
+    }
+    initRows();
+    propagate();
+    if (_infeasible) {
+        util::showWarning("Presolve found the formula infeasible, solving it unreduced");
+        setIdentity();
+        return *_formula;
+    }
+
+    // fix collapsed vars, keep the referenced ones
+    vector<bool> referenced(_keepVar);
+    _newVar.assign(_varCnt, 0);
+    _fixedValue.assign(_varCnt, 0);
+    Int fixedCnt = 0;
+    for (Int var = 0; var < _varCnt; var++) {
+        if (!_keepVar[var] && _lb[var] == _ub[var]) {
+            _newVar[var]     = undef;
+            _fixedValue[var] = _lb[var];
+            fixedCnt++;
+        }
+    }
+
+    vector<bool> keepRow(_rows.size(), false);
+    std::map<vector<Pair<Int, Float> >, Int> rowIndex;      // sorted terms -> kept row, duplicates keep the tighter limit
+    Int mergedCnt = 0;
+    for (Int i = 0, size = _rows.size(); i < size; i++) {
+        Row& row = _rows[i];
+        if (!reduceRow(row)) {
+            if (row._terms.empty() && row._limit < -EPS) {
+                util::showWarning("Presolve found the formula infeasible, solving it unreduced");
+                setIdentity();
+                return *_formula;
+            }
+            continue;
+        }
+
+        vector<Pair<Int, Float> > key(row._terms);
+        std::sort(key.begin(), key.end());
+        auto it = rowIndex.find(key);
+        if (it != rowIndex.end()) {
+            Row& kept = _rows[it->second];
+            kept._limit = std::min(kept._limit, row._limit);
+            mergedCnt++;
+            continue;
+        }
+        rowIndex[key] = i;
+        keepRow[i]    = true;
+        for (const Pair<Int, Float>& term : row._terms) referenced[term.first] = true;
+    }
+
+    // vars left in no row take their lower bound
+    Int freeCnt = 0;
+    for (Int var = 0; var < _varCnt; var++) {
+        if (_newVar[var] == undef || referenced[var]) continue;
+        _newVar[var]     = undef;
+        _fixedValue[var] = _lb[var];
+        freeCnt++;
+    }
+    _newVarCnt = 0;
+    for (Int var = 0; var < _varCnt; var++) {
+        if (_newVar[var] != undef) _newVar[var] = _newVarCnt++;
+    }
+
+    NIA_Formula res = genReducedFormula(keepRow);
+    cout << "#presolve: vars " << _varCnt << " -> " << res.getVarCnt() << " (fixed " << fixedCnt << ", free " << freeCnt << ")"
+         << ", cons " << _formula->getConsCnt() << " -> " << res.getConsCnt() << " (merged " << mergedCnt << ")"
+         << " in " << util::getSeconds(presolveTime) << "s" << endl;
+    return res;
+}
+
+vector<Int> Presolver::postsolve(const vector<Int>& values) const {
+    assert((Int) values.size() == _newVarCnt);
+    vector<Int> res(_varCnt);
+    for (Int var = 0; var < _varCnt; var++) res[var] = _newVar[var] == undef ? _fixedValue[var] : values[_newVar[var]];
+    return res;
+}
+
+/**
+ * @brief "var = value" per original var, with its name if the formula has names
+ *        the search only knows the reduced vars, its output goes through here
+ */
+void Presolver::displayAssignment(ostream& out, const vector<Int>& values) const {
+    const vector<string>& varNames = _formula->getVarNames();
+    vector<Int> origin = postsolve(values);
+    for (Int var = 0; var < _varCnt; var++) {
+        out << var << " = " << origin[var];
+        if (!varNames.empty()) out << "  (" << varNames[var] << ")";
+        out << endl;
+    }
+}
+
+vector<Int> Presolver::presolveValues(const vector<Int>& values) const {
+    assert((Int) values.size() == _varCnt);
+    vector<Int> res(_newVarCnt);
+    for (Int var = 0; var < _varCnt; var++) {
+        if (_newVar[var] != undef) res[_newVar[var]] = values[var];
+    }
+    return res;
+}
+
+} // namespace LS_NIA
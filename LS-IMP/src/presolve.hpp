@@ -0,0 +1,59 @@
+#pragma once
+
+#include "utils.hpp"
+#include "formula.hpp"
+
+namespace LS_NIA {
+
+/**
+ * @brief reduces a formula before search, every var is >= 0 as in LsSolver
+ *        bounds are propagated through the linear rows, vars whose domain collapses are fixed,
+ *        redundant, singleton and emptied rows are dropped, duplicate linear rows are merged
+ *        vars of nonlinear rows and of the objective are never removed, they keep their tightened bounds
+ *        postsolve() maps an assignment of the reduced formula back to the original vars
+ */
+class Presolver {
+protected:
+    // linear row as sum coef * var <= limit, >= rows are negated
+    struct Row {
+        vector<Pair<Int, Float> > _terms;
+        Float _limit;
+        Int   _consIndex;
+        bool  _negated;             // was a >= row
+    };
+
+    const NIA_Formula* _formula;
+    Int                _varCnt;
+    vector<Float>      _lb;
+    vector<Float>      _ub;         // +inf if unbounded
+    vector<bool>       _keepVar;    // in a nonlinear row or in the objective
+    vector<Row>        _rows;
+    bool               _infeasible;
+
+    vector<Int>        _newVar;     // .at(var) = var in the reduced formula, undef if removed
+    vector<Int>        _fixedValue; // .at(var) = value of a removed var
+    Int                _newVarCnt;
+
+    const static Int MAX_PASS = 20;
+
+    void initRows();
+    bool propagateRow(const Row& row);
+    void propagate();
+    bool reduceRow(Row& row) const;             // substitute removed vars, false if the row can be dropped
+    Polynomial renamePolynomial(const Polynomial& poly) const;
+    NIA_Formula genReducedFormula(const vector<bool>& keepRow);
+    void setIdentity();
+
+public:
+    explicit Presolver(const NIA_Formula& formula);
+
+    NIA_Formula presolve();
+
+    vector<Int> postsolve(const vector<Int>& values) const;         // reduced -> original vars
+    vector<Int> presolveValues(const vector<Int>& values) const;    // original -> reduced vars, for warm starts
+    void        displayAssignment(ostream& out, const vector<Int>& values) const;  // values of the reduced vars, printed postsolved
+
+    const static Int undef;
+};
+
+} // namespace LS_NIA
@@ -0,0 +1,259 @@
+#include "serialize.hpp"
+
+#include <cstring>
+
+namespace LS_NIA {
+
+const char     FormulaCache::MAGIC[8] = {'L', 'S', 'N', 'I', 'A', 'F', 'C', '\0'};
+const uint32_t FormulaCache::VERSION  = 3;       // 2: explicit var bounds, 3: flat polynomial terms
+
+/**
+ * @brief appends fixed size fields to a byte buffer
+ */
+class FormulaCache::Writer {
+protected:
+    vector<char> _buffer;
+
+public:
+    template <typename T>
+    void put(T value) {
+        size_t offset = _buffer.size();
+        _buffer.resize(offset + sizeof(T));
+        memcpy(_buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // x87 long double has padding bytes, zero them so equal formulas give equal files
+    void putFloat(Float value) {
+        unsigned char bytes[sizeof(Float)];
+        memset(bytes, 0, sizeof(Float));
+        memcpy(bytes, &value, std::numeric_limits<Float>::digits == 64 ? 10 : sizeof(Float));
+        size_t offset = _buffer.size();
+        _buffer.resize(offset + sizeof(Float));
+        memcpy(_buffer.data() + offset, bytes, sizeof(Float));
+    }
+
+    void putString(const string& str) {
+        put<uint32_t>(str.size());
+        _buffer.insert(_buffer.end(), str.begin(), str.end());
+    }
+
+    const vector<char>& buffer() const { return _buffer; }
+};
+
+/**
+ * @brief bounds checked cursor over the mapped payload
+ */
+class FormulaCache::Reader {
+protected:
+    const char* _cur;
+    const char* _end;
+
+    inline void require(size_t size) {
+        if ((size_t) (_end - _cur) < size) util::showError("Formula cache truncated");
+    }
+
+public:
+    Reader(const char* data, size_t size) : _cur(data), _end(data + size) {}
+
+    template <typename T>
+    T get() {
+        require(sizeof(T));
+        T value;
+        memcpy(&value, _cur, sizeof(T));
+        _cur += sizeof(T);
+        return value;
+    }
+
+    Float getFloat() { return get<Float>(); }
+
+    string getString() {
+        uint32_t size = get<uint32_t>();
+        require(size);
+        string str(_cur, size);
+        _cur += size;
+        return str;
+    }
+
+    inline bool done() const { return _cur == _end; }
+};
+
+uint64_t FormulaCache::checksum(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// the flat term arrays of the Polynomial, written as they are
+void FormulaCache::writePolynomial(Writer& writer, const Polynomial& poly) {
+    writer.put<uint8_t>(poly._linearFlag);
+    writer.put<uint8_t>(poly._normalFlag);
+    writer.put<uint64_t>(poly._coefs.size());
+    writer.put<uint64_t>(poly._vars.size());
+    for (Float coef : poly._coefs) writer.putFloat(coef);
+    for (uint32_t end : poly._termEnd) writer.put<uint32_t>(end);
+    for (const Variable& var : poly._vars) writer.put<uint32_t>(var);
+}
+
+void FormulaCache::readPolynomial(Reader& reader, Polynomial& poly) {
+    poly._linearFlag = reader.get<uint8_t>();
+    poly._normalFlag = reader.get<uint8_t>();
+    uint64_t termCnt = reader.get<uint64_t>();
+    uint64_t varCnt  = reader.get<uint64_t>();
+    poly._coefs.resize(termCnt);
+    poly._termEnd.resize(termCnt);
+    poly._vars.resize(varCnt);
+    for (Float& coef : poly._coefs) coef = reader.getFloat();
+    uint32_t begin = 0;
+    for (uint32_t& end : poly._termEnd) {
+        end = reader.get<uint32_t>();
+        if (end < begin || end > varCnt) util::showError("Formula cache has a broken polynomial");
+        begin = end;
+    }
+    if (begin != varCnt) util::showError("Formula cache has a broken polynomial");
+    for (Variable& var : poly._vars) var = reader.get<uint32_t>();
+}
+
+void FormulaCache::dump(const NIA_Formula& formula, const string& filePath) {
+    Writer writer;
+
+    writer.put<uint64_t>(formula._varCnt);
+    writer.put<uint64_t>(formula._consVec.size());
+    for (const Constraint& cons : formula._consVec) {
+        writer.put<uint8_t>(cons._kind);
+        writer.put<uint8_t>(cons._op);
+        writer.putFloat(cons._limit);
+        if (cons.isFactored()) {
+            assert(cons._factors.size() == Constraint::factorCnt);
+            for (const Polynomial& factor : cons._factors) writePolynomial(writer, factor);
+        }
+        else writePolynomial(writer, cons._poly);
+    }
+    writePolynomial(writer, formula._objectiveFuntion);
+
+    writer.put<uint64_t>(formula._varNames.size());
+    for (const string& name : formula._varNames) writer.putString(name);
+
+    assert(formula._varLB.size() == formula._varUB.size());
+    writer.put<uint64_t>(formula._varLB.size());
+    for (Int lb : formula._varLB) writer.put<int64_t>(lb);
+    for (Int ub : formula._varUB) writer.put<int64_t>(ub);
+
+    const vector<char>& payload = writer.buffer();
+    Header header;
+    memcpy(header._magic, MAGIC, sizeof(MAGIC));
+    header._version     = VERSION;
+    header._floatSize   = sizeof(Float);
+    header._payloadSize = payload.size();
+    header._checksum    = checksum(payload.data(), payload.size());
+
+    std::ofstream fout(filePath, std::ios::binary | std::ios::trunc);
+    if (!fout) util::showError("Cannot write formula cache " + filePath);
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(payload.data(), payload.size());
+    if (!fout) util::showError("Failed writing formula cache " + filePath);
+
+    if (DEBUG) cout << "Formula dumped to " << filePath << " (" << sizeof(header) + payload.size() << " bytes)" << endl;
+}
+
+NIA_Formula FormulaCache::load(const string& filePath) {
+    TimePoint loadTime = util::getTimePoint();
+    MappedFile file(filePath);
+
+    if (file.size() < sizeof(Header)) util::showError("Not a formula cache: " + filePath);
+    Header header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header._magic, MAGIC, sizeof(MAGIC)) != 0) util::showError("Not a formula cache: " + filePath);
+    if (header._version != VERSION) util::showError("Formula cache version " + to_string(header._version) + " != " + to_string(VERSION));
+    if (header._floatSize != sizeof(Float)) util::showError("Formula cache written with another Float layout");
+    if (header._payloadSize != file.size() - sizeof(Header)) util::showError("Formula cache truncated");
+
+    const char* payload = file.data() + sizeof(Header);
+    if (checksum(payload, header._payloadSize) != header._checksum) util::showError("Formula cache checksum mismatch");
+
+    Reader reader(payload, header._payloadSize);
+    NIA_Formula formula;
+
+    formula._varCnt  = reader.get<uint64_t>();
+    uint64_t consCnt = reader.get<uint64_t>();
+    formula._consVec.resize(consCnt);
+    for (Constraint& cons : formula._consVec) {
+        cons._kind  = (ConsKind) reader.get<uint8_t>();
+        cons._op    = (Op) reader.get<uint8_t>();
+        cons._limit = reader.getFloat();
+        if (cons.isFactored()) {
+            cons._factors.resize(Constraint::factorCnt);
+            for (Polynomial& factor : cons._factors) readPolynomial(reader, factor);
+        }
+        else readPolynomial(reader, cons._poly);
+    }
+    readPolynomial(reader, formula._objectiveFuntion);
+
+    uint64_t nameCnt = reader.get<uint64_t>();
+    formula._varNames.resize(nameCnt);
+    for (string& name : formula._varNames) name = reader.getString();
+
+    uint64_t boundCnt = reader.get<uint64_t>();
+    formula._varLB.resize(boundCnt);
+    formula._varUB.resize(boundCnt);
+    for (Int& lb : formula._varLB) lb = reader.get<int64_t>();
+    for (Int& ub : formula._varUB) ub = reader.get<int64_t>();
+
+    if (!reader.done()) util::showError("Formula cache has trailing bytes");
+
+    if (DEBUG) cout << "Formula loaded from " << filePath << " in " << util::getSeconds(loadTime) << "s" << endl;
+    return formula;
+}
+
+vector<Int> SolutionFile::read(const NIA_Formula& formula, const string& filePath) {
+    std::ifstream fin(filePath);
+    if (!fin) util::showError("Cannot open solution file " + filePath);
+
+    const vector<string>& varNames = formula.getVarNames();
+    Map<string, Int> nameMap;
+    for (Int var = 0, size = varNames.size(); var < size; var++) {
+        if (!varNames[var].empty()) nameMap[varNames[var]] = var;
+    }
+
+    vector<Int> values(formula.getVarCnt(), 0);
+    Int    unknownCnt = 0;
+    string line;
+    while (std::getline(fin, line)) {
+        size_t end = line.find_last_not_of(" \t\r");
+        if (end == string::npos || line[line.find_first_not_of(" \t")] == '#') continue;
+        size_t split = line.find_last_of(" \t", end);
+        if (split == string::npos) util::showError("Expect \"<var> <value>\" in " + filePath + ": " + line);
+
+        Int    value = util::parseInt(line.data() + split + 1, line.data() + end + 1);
+        size_t begin = line.find_first_not_of(" \t");
+        string name  = line.substr(begin, line.find_last_not_of(" \t", split) + 1 - begin);
+
+        Map<string, Int>::const_iterator it = nameMap.find(name);
+        Int var = -1;
+        if (it != nameMap.end()) var = it->second;
+        else if (name.find_first_not_of("0123456789") == string::npos) var = std::stoll(name);
+
+        if (var < 0 || var >= formula.getVarCnt()) unknownCnt++;
+        else values[var] = value;
+    }
+    if (unknownCnt > 0) util::showWarning(to_string(unknownCnt) + " unknown vars skipped in " + filePath);
+    return values;
+}
+
+void SolutionFile::write(const NIA_Formula& formula, const vector<Int>& values, const string& filePath) {
+    std::ofstream fout(filePath, std::ios::trunc);
+    if (!fout) util::showError("Cannot write solution file " + filePath);
+
+    const vector<string>& varNames = formula.getVarNames();
+    for (Int var = 0, size = values.size(); var < size; var++) {
+        if (values[var] == 0) continue;
+        if (var < (Int) varNames.size() && !varNames[var].empty()) fout << varNames[var];
+        else fout << var;
+        fout << " " << values[var] << "\n";
+    }
+    if (!fout) util::showError("Failed writing solution file " + filePath);
+}
+
+} // namespace LS_NIA
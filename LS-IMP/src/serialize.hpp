@@ -0,0 +1,53 @@
+#pragma once
+
+#include "utils.hpp"
+#include "formula.hpp"
+
+namespace LS_NIA {
+
+/**
+ * @brief binary cache of a compiled NIA_Formula, skips text parsing and polynomial expansion
+ *
+ * layout: Header | payload
+ *         payload is a flat little-endian stream, checksum is FNV-1a 64 over the payload
+ *         a file written by another version, or with another Float layout, is rejected
+ */
+class FormulaCache {
+protected:
+    struct Header {
+        char     _magic[8];
+        uint32_t _version;
+        uint32_t _floatSize;         // sizeof(Float)
+        uint64_t _payloadSize;
+        uint64_t _checksum;
+    };
+
+    static const char     MAGIC[8];
+    static const uint32_t VERSION;
+
+    class Writer;
+    class Reader;
+
+    static void writePolynomial(Writer& writer, const Polynomial& poly);
+    static void readPolynomial(Reader& reader, Polynomial& poly);
+
+public:
+    static uint64_t checksum(const char* data, size_t size);
+
+    static void        dump(const NIA_Formula& formula, const string& filePath);
+    static NIA_Formula load(const string& filePath);
+};
+
+/**
+ * @brief text assignment, one "<var> <value>" per line, vars not listed are 0
+ *        <var> is the original name (lp name, or "usrID supplyID demandID") or the var id
+ *        the value is the last field, '#' starts a comment line
+ */
+class SolutionFile {
+public:
+    // .at(var) = value, unknown vars are skipped with one warning
+    static vector<Int> read(const NIA_Formula& formula, const string& filePath);
+    static void        write(const NIA_Formula& formula, const vector<Int>& values, const string& filePath);
+};
+
+} // namespace LS_NIA
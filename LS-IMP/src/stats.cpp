@@ -0,0 +1,58 @@
+#include "stats.hpp"
+
+#include <mutex>
+
+namespace LS_NIA {
+
+void SearchStats::clear() {
+    for (Int i = 0; i < MOVE_CNT; i++) _moveCalls[i] = _moveSuccess[i] = _moveCycles[i] = 0;
+    for (Int i = 0; i < PHASE_CNT; i++) _phaseCycles[i] = 0;
+    for (Int i = 0; i < POOL_BUCKET_CNT; i++) _poolSize[i] = 0;
+    _poolSizeSum = 0;
+}
+
+const char* SearchStats::moveName(Move move) {
+    static const char* names[MOVE_CNT] = {
+        "lift", "feasible_sat", "feasible_unsat",
+        "objective_bound", "objective_two_level", "sample_sat",
+        "random_walk_sat", "random_walk_sat_obj", "random_walk_unsat"
+    };
+    return names[move];
+}
+
+const char* SearchStats::phaseName(Phase phase) {
+    static const char* names[PHASE_CNT] = {"score", "update"};
+    return names[phase];
+}
+
+void SearchStats::report(const string& filePath, Int threadIndex, Int step, Float seconds, bool final) const {
+    std::ostringstream out;
+    out << "{\"thread\":" << threadIndex << ",\"final\":" << (final ? "true" : "false")
+        << ",\"step\":" << step << ",\"seconds\":" << seconds << ",\"moves\":{";
+    bool first = true;
+    for (Int i = 0; i < MOVE_CNT; i++) {
+        if (_moveCalls[i] == 0) continue;
+        out << (first ? "" : ",") << "\"" << moveName((Move) i) << "\":{\"calls\":" << _moveCalls[i]
+            << ",\"success\":" << _moveSuccess[i] << ",\"cycles\":" << _moveCycles[i] << "}";
+        first = false;
+    }
+    out << "},\"cycles\":{";
+    for (Int i = 0; i < PHASE_CNT; i++) {
+        out << (i == 0 ? "" : ",") << "\"" << phaseName((Phase) i) << "\":" << _phaseCycles[i];
+    }
+    out << "},\"pool_size_sum\":" << _poolSizeSum << ",\"pool_size_log2\":[";
+    Int lastBucket = POOL_BUCKET_CNT - 1;
+    while (lastBucket > 0 && _poolSize[lastBucket] == 0) lastBucket--;
+    for (Int i = 0; i <= lastBucket; i++) out << (i == 0 ? "" : ",") << _poolSize[i];
+    out << "]}\n";
+
+    static std::mutex mutex;        // portfolio threads report to the same sink
+    std::lock_guard<std::mutex> lock(mutex);
+    if (filePath.empty()) std::cerr << out.str() << std::flush;
+    else {
+        std::ofstream fout(filePath, std::ios::app);
+        fout << out.str();
+    }
+}
+
+} // namespace LS_NIA
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "utils.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @brief search telemetry, compiled only with -DLS_STATS (cmake -DLS_STATS=ON)
+ *        STATS(stmt)            stmt exists only in stats builds
+ *        STATS_MOVE(move, call) evaluates call (a bool), counts and times it as SearchStats::move
+ */
+#ifdef LS_STATS
+#define STATS(stmt) stmt
+#define STATS_MOVE(move, call) (_stats.timeMove(SearchStats::move, [&]() -> bool { return (call); }))
+#else
+#define STATS(stmt)
+#define STATS_MOVE(move, call) (call)
+#endif
+
+namespace LS_NIA {
+
+class SearchStats {
+public:
+    enum Move {
+        LIFT, FEASIBLE_SAT, FEASIBLE_UNSAT,
+        OBJECTIVE_BOUND, OBJECTIVE_TWO_LEVEL, SAMPLE_SAT,
+        RANDOM_WALK_SAT, RANDOM_WALK_SAT_OBJ, RANDOM_WALK_UNSAT,
+        MOVE_CNT
+    };
+    enum Phase { SCORE, UPDATE, PHASE_CNT };       // scoring candidates in selectOperatorAndMove, setVarWithNewVal
+
+    const static Int POOL_BUCKET_CNT = 32;         // bucket k counts pool sizes in [2^(k-1), 2^k), bucket 0 is empty pools
+
+protected:
+    uint64_t _moveCalls[MOVE_CNT];
+    uint64_t _moveSuccess[MOVE_CNT];
+    uint64_t _moveCycles[MOVE_CNT];                // including the update of a successful move
+    uint64_t _phaseCycles[PHASE_CNT];
+    uint64_t _poolSize[POOL_BUCKET_CNT];
+    uint64_t _poolSizeSum;
+
+    static const char* moveName(Move move);
+    static const char* phaseName(Phase phase);
+
+public:
+    SearchStats() { clear(); }
+    void clear();
+
+    // time stamp counter where available, ns otherwise, only differences are meaningful
+    static inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    template <typename Call>
+    inline bool timeMove(Move move, Call call) {
+        uint64_t start = cycles();
+        bool success = call();
+        _moveCycles[move] += cycles() - start;
+        _moveCalls[move]++;
+        _moveSuccess[move] += success;
+        return success;
+    }
+
+    inline void addCycles(Phase phase, uint64_t cnt) { _phaseCycles[phase] += cnt; }
+
+    inline void countPoolSize(Int size) {
+        Int bucket = 0;
+        for (uint64_t s = size; s > 0 && bucket < POOL_BUCKET_CNT - 1; s >>= 1) bucket++;
+        _poolSize[bucket]++;
+        _poolSizeSum += size;
+    }
+
+    // one JSON object on one line, appended to filePath or written to stderr if filePath is empty
+    void report(const string& filePath, Int threadIndex, Int step, Float seconds, bool final) const;
+};
+
+} // namespace LS_NIA
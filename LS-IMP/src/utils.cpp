@@ -2,6 +2,10 @@
 
 #include "utils.hpp"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 /* debug flags ****************************************************************/
 const bool DEBUG = true;
 const bool JUDGE = false;
@@ -27,8 +31,6 @@ const Int NIA_NUM = 10;            // 100 3.7 constraint
 Int randomSeed = DEFAULT_RANDOM_SEED;
 TimePoint startTime;
 
-std::mt19937 genRandom;
-
 /* namespaces *****************************************************************/
 
 /* namespace util *************************************************************/
@@ -40,13 +42,14 @@ std::mt19937 genRandom;
 // }
 
 void util::setRandom(Int seed) {
-    genRandom = std::mt19937(seed);
+    randomSeed = seed;
 }
 
 void util::testRandom() {
+    Random random(randomSeed);
     Int times = 10;
     while (times --) {
-        cout << genRandom() << endl;
+        cout << random() << endl;
     }
 }
 
@@ -99,6 +102,38 @@ vector<string> util::splitStr(const string str, char splitFlag) {
     return res;
 }
 
+/* functions: zero-copy text scanning ****************************************/
+
+uint64_t util::hashBytes(const char* data, size_t size) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 31;
+        data += 8;
+        size -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data, size);
+    hash = (hash ^ tail) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 29);
+}
+
+Int util::parseInt(const char* begin, const char* end) {
+    bool negative = begin != end && *begin == '-';
+    if (negative) begin++;
+    if (begin == end) showError("Expect an integer, got an empty field");
+
+    Int res = 0;
+    for (const char* p = begin; p != end; p++) {
+        unsigned digit = (unsigned char) *p - '0';
+        if (digit > 9) showError("Expect an integer, got \"" + string(begin, end) + "\"");
+        res = res * 10 + digit;
+    }
+    return negative ? -res : res;
+}
+
 /* functions: timing **********************************************************/
 
 TimePoint util::getTimePoint() {
@@ -128,8 +163,115 @@ void util::showError(const string& message, bool commented) {
     throw MyError(message, commented);
 }
 
+/* functions: exact values ****************************************************/
+
+Num util::toNum(Float coef) {
+#ifndef LS_FLOAT_VALUE
+    if (coef != std::floor(coef) || std::fabs(coef) >= (Float) std::numeric_limits<Num>::max())
+        showError("Coefficient " + to_string(coef) + " is not a 64-bit integer, rebuild with -DLS_FLOAT_VALUE=ON");
+#endif
+    return coef;
+}
+
 /* classes ********************************************************************/
 
+/* class Random ***************************************************************/
+
+void Random::setSeed(uint64_t seed, uint64_t stream) {
+    for (Int i = 0; i < 4; i++) {      // splitmix64
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        _s[i] = z ^ (z >> 31);
+    }
+    for (uint64_t i = 0; i < stream; i++) jump();
+}
+
+// equivalent to 2^128 calls of operator()
+void Random::jump() {
+    static const uint64_t JUMP[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+
+    uint64_t s[4] = {0, 0, 0, 0};
+    for (Int i = 0; i < 4; i++) {
+        for (Int b = 0; b < 64; b++) {
+            if (JUMP[i] & (1ULL << b)) {
+                for (Int j = 0; j < 4; j++) s[j] ^= _s[j];
+            }
+            (*this)();
+        }
+    }
+    for (Int j = 0; j < 4; j++) _s[j] = s[j];
+}
+
+/* class StrInterner **********************************************************/
+
+Int StrInterner::findSlot(const char* data, size_t size, uint64_t hash) const {
+    size_t mask = _slots.size() - 1;
+    for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+        Int id = _slots[slot];
+        if (id < 0) return slot;
+        if (_hashes[id] == hash && _offsets[id + 1] - _offsets[id] == size
+            && memcmp(_chars.data() + _offsets[id], data, size) == 0) return slot;
+    }
+}
+
+void StrInterner::grow() {
+    vector<Int> slots(_slots.size() * 2, -1);
+    size_t mask = slots.size() - 1;
+    for (Int id = 0, idCnt = size(); id < idCnt; id++) {
+        size_t slot = _hashes[id] & mask;
+        while (slots[slot] >= 0) slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+    _slots.swap(slots);
+}
+
+Int StrInterner::find(StrSpan key) const {
+    return _slots[findSlot(key._begin, key.size(), util::hashBytes(key._begin, key.size()))];
+}
+
+Int StrInterner::intern(StrSpan key, uint64_t hash, bool& inserted) {
+    Int slot = findSlot(key._begin, key.size(), hash);
+    inserted = _slots[slot] < 0;
+    if (!inserted) return _slots[slot];
+
+    Int id = size();
+    _chars.insert(_chars.end(), key._begin, key._end);
+    _offsets.push_back(_chars.size());
+    _hashes.push_back(hash);
+    _slots[slot] = id;
+    if (2 * (size_t) size() > _slots.size()) grow();      // load factor <= 1/2
+    return id;
+}
+
+/* class MappedFile ***********************************************************/
+
+MappedFile::MappedFile(const string& filePath) : _data(nullptr), _size(0) {
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) util::showError("Cannot open " + filePath);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        util::showError("Cannot stat " + filePath);
+    }
+    _size = st.st_size;
+
+    if (_size > 0) {
+        void* addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            util::showError("Cannot mmap " + filePath);
+        }
+        _data = static_cast<const char*>(addr);
+    }
+    close(fd);          // the mapping stays valid
+}
+
+MappedFile::~MappedFile() {
+    if (_data != nullptr) munmap(const_cast<char*>(_data), _size);
+}
+
 /* class MyError **************************************************************/
 
 MyError::MyError(const string& message, bool commented) {
@@ -6,12 +6,16 @@
 #include <unistd.h>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
 #include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <queue>
 #include <random>
 #include <sstream>
 #include <unordered_map>
@@ -33,6 +37,16 @@ using Float = long double;   // std::stold
 using Int   = int_fast32_t;  // std::stoi
 using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
 
+// constraint values and coefficients of the search, exact 64-bit integers, products are formed in 128 bits
+// cmake -DLS_FLOAT_VALUE=ON keeps long double for formulas with fractional coefficients
+#ifdef LS_FLOAT_VALUE
+using Num     = Float;
+using WideNum = Float;
+#else
+using Num     = int64_t;
+using WideNum = __int128;
+#endif
+
 template <typename K, typename V>
 using Map = std::unordered_map<K, V>;
 template <typename T>
@@ -42,11 +56,9 @@ using Pair = std::pair<T1, T2>;
 
 /* global variables ***********************************************************/
 
-extern Int randomSeed;
+extern Int randomSeed;              // master seed, every Random stream is derived from it
 extern TimePoint startTime;
 
-extern std::mt19937 genRandom;
-
 /* debug flags ****************************************************************/
 extern const bool DEBUG;
 extern const bool JUDGE;
@@ -89,6 +101,13 @@ void printHelpOption();
 vector<string> getArgV(int argc, char* argv[]);
 vector<string> splitStr(const string str, char splitFlag = ' ');
 
+/* functions: zero-copy text scanning ***************************************/
+
+uint64_t hashBytes(const char* data, size_t size);
+
+// digits with optional leading '-', anything else is an error
+Int parseInt(const char* begin, const char* end);
+
 /* functions: timing ********************************************************/
 
 TimePoint getTimePoint();
@@ -100,6 +119,72 @@ void printDuration(TimePoint startTime);
 void showWarning(const string& message, bool commented = true);
 void showError(const string& message, bool commented = true);
 
+/* functions: exact values **************************************************/
+
+// coefficient of the formula as a Num, fractional or out of range coefficients are an error in integer builds
+Num toNum(Float coef);
+
+inline bool fitsNum(WideNum value) {
+#ifndef LS_FLOAT_VALUE
+    return value <= std::numeric_limits<Num>::max() && value >= -std::numeric_limits<Num>::max();
+#else
+    return true;
+#endif
+}
+
+// res = a + b and res = a * b, false if res overflows a WideNum
+inline bool addWide(WideNum a, WideNum b, WideNum& res) {
+#ifndef LS_FLOAT_VALUE
+    return !__builtin_add_overflow(a, b, &res);
+#else
+    res = a + b;
+    return true;
+#endif
+}
+
+inline bool mulWide(WideNum a, WideNum b, WideNum& res) {
+#ifndef LS_FLOAT_VALUE
+    return !__builtin_mul_overflow(a, b, &res);
+#else
+    res = a * b;
+    return true;
+#endif
+}
+
+// stored search state must fit a Num, moves are checked by LsSolver::isMoveInRange before, overflow is an error
+inline Num narrowNum(WideNum value) {
+    if (!fitsNum(value)) showError("Constraint value overflows 64 bits, rebuild with -DLS_FLOAT_VALUE=ON");
+    return value;
+}
+
+// clamped to [-max, max], compares against any Int limit as value itself does
+inline Num saturateNum(WideNum value) {
+#ifndef LS_FLOAT_VALUE
+    if (value > std::numeric_limits<Num>::max()) return std::numeric_limits<Num>::max();
+    if (value < -std::numeric_limits<Num>::max()) return -std::numeric_limits<Num>::max();
+#endif
+    return value;
+}
+
+// floor(a / b) and ceil(a / b), b != 0, exact in integer builds
+inline WideNum floorDiv(WideNum a, WideNum b) {
+#ifdef LS_FLOAT_VALUE
+    return std::floor(a / b);
+#else
+    WideNum q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+#endif
+}
+
+inline WideNum ceilDiv(WideNum a, WideNum b) {
+#ifdef LS_FLOAT_VALUE
+    return std::ceil(a / b);
+#else
+    WideNum q = a / b;
+    return (a % b != 0 && (a < 0) == (b < 0)) ? q + 1 : q;
+#endif
+}
+
 /* functions: templates implemented in headers to avoid linker errors *******/
 
 template <typename T>
@@ -194,6 +279,168 @@ void shuffleRandomly(T& container) {
 
 /* classes ********************************************************************/
 
+/**
+ * @brief xoshiro256** engine, 32 bytes of state, one per solver / reader
+ *        state is expanded from the seed by splitmix64
+ *        stream k jumps the state k * 2^128 steps ahead, streams never overlap
+ */
+class Random {
+   protected:
+    uint64_t _s[4];
+
+    static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+   public:
+    explicit Random(uint64_t seed = DEFAULT_RANDOM_SEED, uint64_t stream = 0) { setSeed(seed, stream); }
+    void setSeed(uint64_t seed, uint64_t stream = 0);
+    void jump();
+
+    inline uint64_t operator()() {
+        const uint64_t res = rotl(_s[1] * 5, 7) * 9;
+        const uint64_t t   = _s[1] << 17;
+        _s[2] ^= _s[0];
+        _s[3] ^= _s[1];
+        _s[1] ^= _s[2];
+        _s[0] ^= _s[3];
+        _s[2] ^= t;
+        _s[3] = rotl(_s[3], 45);
+        return res;
+    }
+
+    // uniform in [0, n) without modulo bias, Lemire's multiply-shift with rejection
+    inline uint64_t bounded(uint64_t n) {
+        unsigned __int128 m = (unsigned __int128) (*this)() * n;
+        uint64_t low = (uint64_t) m;
+        if (low < n) {
+            const uint64_t threshold = -n % n;
+            while (low < threshold) {
+                m   = (unsigned __int128) (*this)() * n;
+                low = (uint64_t) m;
+            }
+        }
+        return (uint64_t) (m >> 64);
+    }
+};
+
+/**
+ * @brief subset of [0, universe) as a dense value array plus a position array
+ *        O(1) insert / erase / contains / uniform pick by index, iteration over members only
+ *        erase moves the last member into the hole, so the order is not stable
+ */
+class IndexedSet {
+   protected:
+    vector<Int> _values;          // members, [0, size())
+    vector<Int> _position;        // .at(x) = index of x in _values, -1 if absent
+
+   public:
+    IndexedSet() {}
+    explicit IndexedSet(Int universe) { init(universe); }
+
+    inline void init(Int universe) { _values.clear(); _values.reserve(universe); _position.assign(universe, -1); }
+    inline Int  universe() const { return _position.size(); }
+
+    inline Int  size()  const { return _values.size(); }
+    inline bool empty() const { return _values.empty(); }
+    inline bool contains(Int x) const { return _position[x] >= 0; }
+    inline Int  operator [] (Int i) const { return _values[i]; }
+
+    inline vector<Int>::const_iterator begin() const { return _values.begin(); }
+    inline vector<Int>::const_iterator end()   const { return _values.end(); }
+
+    // false if x is already a member
+    inline bool insert(Int x) {
+        if (_position[x] >= 0) return false;
+        _position[x] = _values.size();
+        _values.push_back(x);
+        return true;
+    }
+
+    // false if x is not a member
+    inline bool erase(Int x) {
+        Int pos = _position[x];
+        if (pos < 0) return false;
+        Int last = _values.back();
+        _values[pos]    = last;
+        _position[last] = pos;
+        _values.pop_back();
+        _position[x] = -1;
+        return true;
+    }
+
+    // O(size()), not O(universe())
+    inline void clear() {
+        for (Int x : _values) _position[x] = -1;
+        _values.clear();
+    }
+};
+
+/**
+ * @brief non-owning [begin, end) view into a buffer, no allocation
+ */
+struct StrSpan {
+    const char* _begin;
+    const char* _end;
+
+    StrSpan() : _begin(nullptr), _end(nullptr) {}
+    StrSpan(const char* begin, const char* end) : _begin(begin), _end(end) {}
+
+    inline size_t size()  const { return _end - _begin; }
+    inline bool   empty() const { return _begin == _end; }
+    inline string str()   const { return string(_begin, _end); }
+
+    // cut the prefix up to the first splitChar, the rest of the span stays in *this
+    inline StrSpan cut(char splitChar) {
+        const char* pos = empty() ? nullptr : static_cast<const char*>(memchr(_begin, splitChar, size()));
+        if (pos == nullptr) pos = _end;
+        StrSpan res(_begin, pos);
+        _begin = pos == _end ? _end : pos + 1;
+        return res;
+    }
+};
+
+/**
+ * @brief string -> dense id in [0, size()), keys stored back to back in one buffer
+ *        open addressing with linear probing, one probe sequence per intern()
+ */
+class StrInterner {
+   protected:
+    vector<char>     _chars;
+    vector<size_t>   _offsets;     // key i is _chars[_offsets[i], _offsets[i + 1])
+    vector<uint64_t> _hashes;      // .at(id)
+    vector<Int>      _slots;       // id or -1, size is a power of 2
+
+    Int  findSlot(const char* data, size_t size, uint64_t hash) const;
+    void grow();
+
+   public:
+    StrInterner() : _offsets(1, 0), _slots(16, -1) {}
+
+    inline Int size() const { return _hashes.size(); }
+
+    Int     find(StrSpan key) const;                 // -1 if absent
+    Int     intern(StrSpan key, bool& inserted) { return intern(key, util::hashBytes(key._begin, key.size()), inserted); }
+    Int     intern(StrSpan key, uint64_t hash, bool& inserted);     // hash = util::hashBytes(key), may be precomputed
+    StrSpan key(Int id) const { return StrSpan(_chars.data() + _offsets[id], _chars.data() + _offsets[id + 1]); }
+};
+
+/**
+ * @brief read-only mmap of a whole file, unmapped on destruction
+ */
+class MappedFile {
+   protected:
+    const char* _data;
+    size_t      _size;
+
+   public:
+    explicit MappedFile(const string& filePath);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    inline const char* data() const { return _data; }
+    inline size_t      size() const { return _size; }
+};
+
 class MyError {
    public:
     MyError(const string& message, bool commented);